@@ -0,0 +1,59 @@
+# Headless clip processing tool, see src/ClipTool.h
+# qmake skeletal-blend-cli.pro && make -f Makefile.cli
+QT -= core gui
+# BVH and Terrain carry their own drawing code, the tool never calls it and needs no display or GL context
+LIBS += -lGL -lGLU
+TEMPLATE = app
+TARGET = ./bin/skeletal-blend-cli
+MAKEFILE = Makefile.cli
+INCLUDEPATH += ./src
+OBJECTS_DIR = ./build/cli-obj
+CONFIG += c++17 thread console
+CONFIG -= app_bundle
+
+# Input
+HEADERS += src/Cartesian3.h \
+           src/Affine3x4.h \
+           src/AssetManager.h \
+           src/BinaryIO.h \
+           src/BVH.h \
+           src/ContentHash.h \
+           src/ChannelLayout.h \
+           src/ClipTool.h \
+           src/ClipView.h \
+           src/FastMath.h \
+           src/FrameArena.h \
+           src/HeightPyramid.h \
+           src/Homogeneous4.h \
+           src/Matrix4.h \
+           src/MemoryTracker.h \
+           src/PoseBatch.h \
+           src/PoseEvaluator.h \
+           src/Quaternion.h \
+           src/Retargeter.h \
+           src/RootMotion.h \
+           src/Skeleton.h \
+           src/Terrain.h \
+           src/ThreadPool.h
+
+SOURCES += src/Cartesian3.cpp \
+           src/Affine3x4.cpp \
+           src/AssetManager.cpp \
+           src/BVH.cpp \
+           src/ChannelLayout.cpp \
+           src/ClipTool.cpp \
+           src/clipToolMain.cpp \
+           src/ClipView.cpp \
+           src/FrameArena.cpp \
+           src/HeightPyramid.cpp \
+           src/Homogeneous4.cpp \
+           src/Matrix4.cpp \
+           src/MemoryTracker.cpp \
+           src/PoseBatch.cpp \
+           src/PoseEvaluator.cpp \
+           src/Quaternion.cpp \
+           src/Retargeter.cpp \
+           src/RootMotion.cpp \
+           src/Skeleton.cpp \
+           src/Terrain.cpp \
+           src/ThreadPool.cpp
@@ -0,0 +1,52 @@
+# Tests of the non-Qt sources, see tests/Tests.h
+# qmake skeletal-blend-tests.pro && make -f Makefile.tests && bin/skeletal-blend-tests
+QT -= core gui
+TEMPLATE = app
+TARGET = ./bin/skeletal-blend-tests
+MAKEFILE = Makefile.tests
+INCLUDEPATH += ./src ./tests
+OBJECTS_DIR = ./build/tests-obj
+CONFIG += c++17 thread console
+CONFIG -= app_bundle
+LIBS += -lGL -lGLU
+
+# Input
+HEADERS += src/Affine3x4.h \
+           src/BVH.h \
+           src/BinaryIO.h \
+           src/Cartesian3.h \
+           src/ChannelLayout.h \
+           src/ClipView.h \
+           src/ContentHash.h \
+           src/FastMath.h \
+           src/FrameArena.h \
+           src/HeightPyramid.h \
+           src/Homogeneous4.h \
+           src/Matrix4.h \
+           src/MemoryTracker.h \
+           src/RootMotion.h \
+           src/Skeleton.h \
+           src/Terrain.h \
+           src/ThreadPool.h \
+           src/Vec4.h \
+           tests/Tests.h
+
+SOURCES += src/Affine3x4.cpp \
+           src/BVH.cpp \
+           src/Cartesian3.cpp \
+           src/ChannelLayout.cpp \
+           src/ClipView.cpp \
+           src/FrameArena.cpp \
+           src/HeightPyramid.cpp \
+           src/Homogeneous4.cpp \
+           src/Matrix4.cpp \
+           src/MemoryTracker.cpp \
+           src/RootMotion.cpp \
+           src/Skeleton.cpp \
+           src/Terrain.cpp \
+           src/ThreadPool.cpp \
+           tests/ChannelLayoutTest.cpp \
+           tests/ClipEncodingTest.cpp \
+           tests/FastMathTest.cpp \
+           tests/TerrainTest.cpp \
+           tests/testMain.cpp
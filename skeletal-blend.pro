@@ -5,7 +5,7 @@ TARGET = ./bin/skeletal-blend
 INCLUDEPATH += ./src
 OBJECTS_DIR=./build/obj
 MOC_DIR=./build/moc
-CONFIG += c++17
+CONFIG += c++17 thread
 
 # You can make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -16,22 +16,72 @@ CONFIG += c++17
 
 # Input
 HEADERS += src/Cartesian3.h \
+           src/Affine3x4.h \
            src/AnimationCycleWidget.h \
+           src/AnimationLod.h \
+           src/AssetManager.h \
+           src/BinaryIO.h \
            src/BVH.h \
+           src/ContentHash.h \
+           src/ChannelLayout.h \
+           src/ClipView.h \
+           src/Crowd.h \
+           src/FastMath.h \
+           src/FootIk.h \
+           src/FrameArena.h \
+           src/HeightPyramid.h \
            src/Homogeneous4.h \
-           src/HomogeneousFaceSurface.h \
+           src/Inertialization.h \
            src/Matrix4.h \
+           src/MemoryTracker.h \
+           src/MotionDatabase.h \
+           src/PoseAtlas.h \
+           src/PoseBatch.h \
+           src/PoseCache.h \
+           src/PoseEvaluator.h \
+           src/Retargeter.h \
            src/Scene.h \
+           src/Skeleton.h \
+           src/SpscQueue.h \
+           src/StateMachine.h \
            src/Terrain.h \
+           src/ThreadPool.h \
+           src/TransitionTable.h \
+           src/TripleBuffer.h \
+           src/UpdateThread.h \
+           src/Vec4.h \
+           src/RootMotion.h \
            src/Quaternion.cpp
 
 SOURCES += src/Cartesian3.cpp \
+           src/Affine3x4.cpp \
            src/AnimationCycleWidget.cpp \
+           src/AnimationLod.cpp \
+           src/AssetManager.cpp \
            src/BVH.cpp \
+           src/ChannelLayout.cpp \
+           src/ClipView.cpp \
+           src/Crowd.cpp \
+           src/FootIk.cpp \
+           src/FrameArena.cpp \
+           src/HeightPyramid.cpp \
            src/Homogeneous4.cpp \
-           src/HomogeneousFaceSurface.cpp \
+           src/Inertialization.cpp \
            src/main.cpp \
            src/Matrix4.cpp \
+           src/MemoryTracker.cpp \
+           src/MotionDatabase.cpp \
+           src/PoseAtlas.cpp \
+           src/PoseBatch.cpp \
+           src/PoseCache.cpp \
+           src/PoseEvaluator.cpp \
+           src/Retargeter.cpp \
            src/Scene.cpp \
+           src/Skeleton.cpp \
+           src/StateMachine.cpp \
            src/Terrain.cpp \
+           src/ThreadPool.cpp \
+           src/TransitionTable.cpp \
+           src/UpdateThread.cpp \
+           src/RootMotion.cpp \
            src/Quaternion.cpp
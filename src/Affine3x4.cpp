@@ -0,0 +1,170 @@
+#include "Affine3x4.h"
+
+#include <iomanip>
+
+Affine3x4::Affine3x4() {
+    for (int row = 0; row < 3; row++) {
+        rows[row][row] = 1.0f;
+    }
+}
+
+Affine3x4::Affine3x4(const Matrix4& matrix) {
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            rows[row][col] = matrix[row][col];
+        }
+    }
+}
+
+Vec4& Affine3x4::operator [](const int rowIndex) {
+    return rows[rowIndex];
+}
+
+const Vec4& Affine3x4::operator [](const int rowIndex) const {
+    return rows[rowIndex];
+}
+
+Affine3x4 Affine3x4::operator *(const Affine3x4& other) const {
+    Affine3x4 result;
+
+    for (int row = 0; row < 3; row++) {
+        const float* left = rows[row].coordinates;
+        for (int col = 0; col < 4; col++) {
+            result.rows[row][col] = left[0] * other.rows[0][col] +
+                                    left[1] * other.rows[1][col] +
+                                    left[2] * other.rows[2][col];
+        }
+        // the implicit bottom row of other only contributes to the translation
+        result.rows[row][3] += left[3];
+    }
+
+    return result;
+}
+
+Cartesian3 Affine3x4::transformPoint(const Cartesian3& point) const {
+    return Cartesian3(rows[0][0] * point.x + rows[0][1] * point.y + rows[0][2] * point.z + rows[0][3],
+                      rows[1][0] * point.x + rows[1][1] * point.y + rows[1][2] * point.z + rows[1][3],
+                      rows[2][0] * point.x + rows[2][1] * point.y + rows[2][2] * point.z + rows[2][3]);
+}
+
+Cartesian3 Affine3x4::transformVector(const Cartesian3& vector) const {
+    return Cartesian3(rows[0][0] * vector.x + rows[0][1] * vector.y + rows[0][2] * vector.z,
+                      rows[1][0] * vector.x + rows[1][1] * vector.y + rows[1][2] * vector.z,
+                      rows[2][0] * vector.x + rows[2][1] * vector.y + rows[2][2] * vector.z);
+}
+
+Cartesian3 Affine3x4::origin() const {
+    return Cartesian3(rows[0][3], rows[1][3], rows[2][3]);
+}
+
+Affine3x4 Affine3x4::inverse() const {
+    // columns of the linear part, the rows of its inverse are their pairwise cross products over the determinant
+    const Cartesian3 x(rows[0][0], rows[1][0], rows[2][0]);
+    const Cartesian3 y(rows[0][1], rows[1][1], rows[2][1]);
+    const Cartesian3 z(rows[0][2], rows[1][2], rows[2][2]);
+    const Cartesian3 yz = y.cross(z);
+    const Cartesian3 zx = z.cross(x);
+    const Cartesian3 xy = x.cross(y);
+    const float inverseDeterminant = 1.0f / x.dot(yz);
+
+    Affine3x4 result;
+    const Cartesian3 inverseRows[3] = {inverseDeterminant * yz, inverseDeterminant * zx, inverseDeterminant * xy};
+    const Cartesian3 translation = origin();
+    for (int row = 0; row < 3; row++) {
+        result.rows[row] = Vec4(inverseRows[row], -inverseRows[row].dot(translation));
+    }
+
+    return result;
+}
+
+Matrix4 Affine3x4::matrix() const {
+    Matrix4 result;
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            result.coordinates[row][col] = rows[row][col];
+        }
+    }
+    result.coordinates[3][3] = 1.0f;
+
+    return result;
+}
+
+Affine3x4 Affine3x4::identity() {
+    return Affine3x4();
+}
+
+Affine3x4 Affine3x4::translation(const Cartesian3& vector) {
+    Affine3x4 result;
+
+    for (int row = 0; row < 3; row++) {
+        result.rows[row][3] = vector[row];
+    }
+
+    return result;
+}
+
+Affine3x4 Affine3x4::rotationX(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
+
+    Affine3x4 result;
+    result.rows[1][1] = cosine;
+    result.rows[1][2] = sine;
+    result.rows[2][1] = -sine;
+    result.rows[2][2] = cosine;
+
+    return result;
+}
+
+Affine3x4 Affine3x4::rotationY(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
+
+    Affine3x4 result;
+    result.rows[0][0] = cosine;
+    result.rows[0][2] = -sine;
+    result.rows[2][0] = sine;
+    result.rows[2][2] = cosine;
+
+    return result;
+}
+
+Affine3x4 Affine3x4::rotationZ(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
+
+    Affine3x4 result;
+    result.rows[0][0] = cosine;
+    result.rows[0][1] = sine;
+    result.rows[1][0] = -sine;
+    result.rows[1][1] = cosine;
+
+    return result;
+}
+
+Matrix4 operator *(const Matrix4& matrix, const Affine3x4& affine) {
+    Matrix4 result;
+
+    for (int row = 0; row < 4; row++) {
+        const float* left = matrix[row];
+        for (int col = 0; col < 4; col++) {
+            result.coordinates[row][col] = left[0] * affine.rows[0][col] +
+                                           left[1] * affine.rows[1][col] +
+                                           left[2] * affine.rows[2][col];
+        }
+        result.coordinates[row][3] += left[3];
+    }
+
+    return result;
+}
+
+std::ostream& operator <<(std::ostream& outStream, const Affine3x4& value) {
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            outStream << std::setw(12) << std::setprecision(5) << std::fixed << value.rows[row][col]
+                      << (col == 3 ? "\n" : " ");
+        }
+    }
+    return outStream;
+}
@@ -0,0 +1,63 @@
+#ifndef AFFINE3X4_H
+#define AFFINE3X4_H
+
+#include <iostream>
+
+#include "Cartesian3.h"
+#include "FastMath.h"
+#include "Matrix4.h"
+#include "Vec4.h"
+
+// Transform whose bottom row is always (0, 0, 0, 1): translations, rotations and their products
+// Only the top three rows are stored and multiplied, 48 bytes and 36 multiplies per product
+// against 64 of each for Matrix4, and points are transformed without going through Homogeneous4
+class Affine3x4 {
+public:
+    // stored in row-major form, one aligned row per Vec4
+    Vec4 rows[3];
+
+    // defaults to the identity
+    Affine3x4();
+
+    // drops the bottom row, matrix must be affine
+    explicit Affine3x4(const Matrix4& matrix);
+
+    Vec4& operator [](int rowIndex);
+
+    const Vec4& operator [](int rowIndex) const;
+
+    // other first, then this
+    Affine3x4 operator *(const Affine3x4& other) const;
+
+    Cartesian3 transformPoint(const Cartesian3& point) const;
+
+    // ignores the translation
+    Cartesian3 transformVector(const Cartesian3& vector) const;
+
+    // where the origin is taken, the translation column
+    Cartesian3 origin() const;
+
+    // inverse of an invertible transform, the linear part is inverted through its cofactors
+    Affine3x4 inverse() const;
+
+    // with the bottom row put back, for composing with projections and handing to GL
+    Matrix4 matrix() const;
+
+    static Affine3x4 identity();
+
+    static Affine3x4 translation(const Cartesian3& vector);
+
+    // same conventions as Matrix4::rotationX/Y/Z
+    static Affine3x4 rotationX(float degrees, Precision precision = Precision::Exact);
+
+    static Affine3x4 rotationY(float degrees, Precision precision = Precision::Exact);
+
+    static Affine3x4 rotationZ(float degrees, Precision precision = Precision::Exact);
+};
+
+// matrix * affine as 4x4 matrices, the affine bottom row saves a quarter of the work
+Matrix4 operator *(const Matrix4& matrix, const Affine3x4& affine);
+
+std::ostream& operator <<(std::ostream& outStream, const Affine3x4& value);
+
+#endif
@@ -11,9 +11,16 @@
 #include <GL/glu.h>
 #endif
 
+#include "MemoryTracker.h"
+
 AnimationCycleWidget::AnimationCycleWidget(QWidget* parent, Scene* scene)
     : _GEOMETRIC_WIDGET_PARENT_CLASS(parent),
-      scene(scene) {
+      scene(scene),
+      updateThread([scene]() {
+          MemoryTracker::beginTick();
+          scene->update();
+          MemoryTracker::endTick();
+      }) {
     animationTimer = new QTimer(this);
     connect(animationTimer, SIGNAL(timeout()), this, SLOT(nextFrame()));
     // set the timer to fire 24 times a second
@@ -77,10 +84,20 @@ void AnimationCycleWidget::keyPressEvent(QKeyEvent* event) {
         case Qt::Key_E:
             scene->eventCameraTurnRight();
             break;
+        // instrumentation
+        case Qt::Key_I:
+            scene->eventReport();
+            break;
         // character controls
         case Qt::Key_P:
             scene->eventCharacterReset();
             break;
+        case Qt::Key_M:
+            scene->eventToggleMotionMatching();
+            break;
+        case Qt::Key_C:
+            scene->eventToggleCrowd();
+            break;
         case Qt::Key_Up:
             scene->eventCharacterForward();
             break;
@@ -99,7 +116,8 @@ void AnimationCycleWidget::keyPressEvent(QKeyEvent* event) {
 }
 
 void AnimationCycleWidget::nextFrame() {
-    scene->update();
+    // the next tick is simulated on the update thread while the last one is drawn
+    updateThread.requestTick();
 
     update();
 }
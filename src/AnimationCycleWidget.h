@@ -17,6 +17,7 @@
 #endif
 
 #include "Scene.h"
+#include "UpdateThread.h"
 
 class AnimationCycleWidget : public _GEOMETRIC_WIDGET_PARENT_CLASS {
     Q_OBJECT
@@ -40,6 +41,9 @@ private:
     Scene* scene;
 
     QTimer* animationTimer;
+
+    // declared last, so it is joined before anything it touches is destroyed
+    UpdateThread updateThread;
 };
 
 #endif
@@ -0,0 +1,105 @@
+#include "AnimationLod.h"
+
+LodPolicy::LodPolicy()
+    : distances{80.0f, 160.0f},
+      intervals{1, 2, 4} {
+}
+
+LodSelection LodPolicy::select(const float distance) const {
+    LodSelection selection;
+    while (selection.level < LOD_LEVELS - 1 && distance > distances[selection.level]) {
+        selection.level++;
+    }
+    selection.interval = intervals[selection.level];
+    return selection;
+}
+
+LodPose::LodPose()
+    : previousKey(0),
+      keyFrame(-1),
+      output(&keys[0].jointMatrices()),
+      jointMask(nullptr),
+      recomputed(0) {
+}
+
+void LodPose::evaluate(const BVH& clip,
+                       const int frame,
+                       const float scale,
+                       const LodSelection& lod,
+                       const Cartesian3* rotationOffsets) {
+    jointMask = clip.skeleton->lodMasks[lod.level].data();
+    PoseEvaluator& previous = keys[previousKey];
+
+    // offsets change every tick, there are no key poses to share between ticks
+    if (lod.interval <= 1 || rotationOffsets != nullptr) {
+        previous.evaluate(clip, frame, scale, lod.level, rotationOffsets);
+        recomputed = previous.recomputedJoints();
+        keyFrame = -1;
+        output = &previous.jointMatrices();
+        return;
+    }
+
+    // key frames are the multiples of the interval on either side of frame
+    const int key = frame - frame % lod.interval;
+    const int nextKey = key + lod.interval;
+
+    recomputed = 0;
+    if (key != keyFrame) {
+        // moving on by one window: the old next key becomes the previous one
+        if (key == keyFrame + lod.interval) {
+            previousKey = 1 - previousKey;
+        } else {
+            keys[previousKey].evaluate(clip, key, scale, lod.level);
+            recomputed += keys[previousKey].recomputedJoints();
+        }
+        keyFrame = key;
+    }
+
+    // no-ops unless the clip or detail level changed under the same key frame
+    PoseEvaluator& from = keys[previousKey];
+    PoseEvaluator& to = keys[1 - previousKey];
+    from.evaluate(clip, key, scale, lod.level);
+    recomputed += from.recomputedJoints();
+    to.evaluate(clip, nextKey, scale, lod.level);
+    recomputed += to.recomputedJoints();
+
+    const float t = (frame - key) / static_cast<float>(lod.interval);
+    if (t == 0.0f) {
+        output = &from.jointMatrices();
+        return;
+    }
+
+    // element-wise blend of the key transforms, good enough at the distances throttling is used
+    const std::vector<Affine3x4>& a = from.jointMatrices();
+    const std::vector<Affine3x4>& b = to.jointMatrices();
+    interpolated.resize(a.size());
+    for (size_t joint = 0; joint < a.size(); joint++) {
+        if (!jointMask[joint]) {
+            continue;
+        }
+        for (int row = 0; row < 3; row++) {
+            for (int col = 0; col < 4; col++) {
+                interpolated[joint][row][col] = (1.0f - t) * a[joint][row][col] + t * b[joint][row][col];
+            }
+        }
+    }
+    output = &interpolated;
+}
+
+void LodPose::invalidate() {
+    keys[0].invalidate();
+    keys[1].invalidate();
+    keyFrame = -1;
+}
+
+const std::vector<Affine3x4>& LodPose::jointMatrices() const {
+    return *output;
+}
+
+const unsigned char* LodPose::mask() const {
+    return jointMask;
+}
+
+std::size_t LodPose::recomputedJoints() const {
+    return recomputed;
+}
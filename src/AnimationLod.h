@@ -0,0 +1,65 @@
+#ifndef ANIMATION_LOD_H
+#define ANIMATION_LOD_H
+
+#include <array>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "BVH.h"
+#include "PoseEvaluator.h"
+
+// Joint mask and update rate chosen for a character
+struct LodSelection {
+    // index into Skeleton::lodMasks
+    int level = 0;
+    // FK runs every interval ticks, ticks in between interpolate
+    int interval = 1;
+};
+
+// Picks the level of detail from the distance between camera and character
+class LodPolicy {
+public:
+    LodPolicy();
+
+    LodSelection select(float distance) const;
+
+    // level i is used up to distances[i], the last level beyond
+    std::array<float, LOD_LEVELS - 1> distances;
+    std::array<int, LOD_LEVELS> intervals;
+};
+
+// Character pose evaluated at a level of detail
+// With an update interval N, FK only runs on key frames that are multiples of N
+// and frames in between blend the surrounding key poses
+class LodPose {
+public:
+    LodPose();
+
+    // rotationOffsets are passed on to PoseEvaluator, frames with offsets are evaluated at every tick
+    void evaluate(const BVH& clip, int frame, float scale, const LodSelection& lod,
+                  const Cartesian3* rotationOffsets = nullptr);
+
+    // forces full evaluation of both key poses, needed when a clip's data changes in place
+    void invalidate();
+
+    // model-space transform per joint, only joints in mask() are up to date
+    const std::vector<Affine3x4>& jointMatrices() const;
+
+    const unsigned char* mask() const;
+
+    // joints run through FK by the last evaluation
+    std::size_t recomputedJoints() const;
+
+private:
+    // key poses around the current frame, swapped as frames advance
+    PoseEvaluator keys[2];
+    int previousKey;
+    int keyFrame;
+
+    std::vector<Affine3x4> interpolated;
+    const std::vector<Affine3x4>* output;
+    const unsigned char* jointMask;
+    std::size_t recomputed;
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include "AssetManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#include "ContentHash.h"
+
+ClipHandle::ClipHandle() {
+}
+
+ClipHandle::ClipHandle(std::shared_ptr<ClipSlot> slot): slot(std::move(slot)) {
+}
+
+bool ClipHandle::ready() const {
+    return slot != nullptr && slot->done.load(std::memory_order_acquire);
+}
+
+const BVH* ClipHandle::get() const {
+    return ready() ? slot->clip.get() : nullptr;
+}
+
+const BVH* ClipHandle::wait() const {
+    if (slot == nullptr) {
+        return nullptr;
+    }
+    slot->finished.wait();
+    return get();
+}
+
+bool ClipHandle::failed() const {
+    return ready() && slot->clip == nullptr;
+}
+
+const std::string& ClipHandle::problem() const {
+    static const std::string none;
+    return ready() ? slot->problem : none;
+}
+
+double ClipHandle::latency() const {
+    if (!ready()) {
+        return -1.0;
+    }
+    return std::chrono::duration<double>(slot->completed - slot->requested).count();
+}
+
+std::uint64_t ClipHandle::hash() const {
+    return ready() ? slot->hash : 0;
+}
+
+const std::string& ClipHandle::name() const {
+    static const std::string unnamed;
+    return slot != nullptr ? slot->name : unnamed;
+}
+
+AssetManager::AssetManager(std::string cacheDirectory, const unsigned int threadCount)
+    : cacheDirectory(std::move(cacheDirectory)),
+      pool(threadCount) {
+    if (!this->cacheDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(this->cacheDirectory, error);
+        if (error) {
+            // carry on uncached rather than failing to start
+            this->cacheDirectory.clear();
+        }
+    }
+}
+
+ClipHandle AssetManager::request(const std::string& fileName) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::shared_ptr<ClipSlot>& slot = clips[fileName];
+    if (slot != nullptr) {
+        return ClipHandle(slot);
+    }
+
+    slot = std::make_shared<ClipSlot>();
+    slot->name = fileName;
+    slot->requested = std::chrono::steady_clock::now();
+
+    const std::shared_ptr<ClipSlot> pending = slot;
+    slot->finished = pool.submit([this, pending]() {
+        pending->clip = loadClip(pending->name, pending->hash, pending->problem);
+        pending->completed = std::chrono::steady_clock::now();
+        pending->done.store(true, std::memory_order_release);
+    }).share();
+
+    return ClipHandle(slot);
+}
+
+ClipHandle AssetManager::request(const std::string& fileName, const ClipView& view) {
+    if (view.identity()) {
+        return request(fileName);
+    }
+
+    // queued ahead of the view, so the view's task never waits on a load that has not started
+    const ClipHandle source = request(fileName);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::string name = fileName + " " + view.describe();
+    std::shared_ptr<ClipSlot>& slot = clips[name];
+    if (slot != nullptr) {
+        return ClipHandle(slot);
+    }
+
+    slot = std::make_shared<ClipSlot>();
+    slot->name = name;
+    slot->requested = std::chrono::steady_clock::now();
+
+    const std::shared_ptr<ClipSlot> pending = slot;
+    slot->finished = pool.submit([pending, source, view]() {
+        source.wait();
+        if (source.slot->clip != nullptr) {
+            std::shared_ptr<BVH> viewed = std::make_shared<BVH>();
+            if (viewed->makeView(source.slot->clip, view, pending->problem)) {
+                pending->clip = viewed;
+                pending->hash = view.hash(source.hash());
+            }
+        } else {
+            pending->problem = source.problem();
+        }
+        pending->completed = std::chrono::steady_clock::now();
+        pending->done.store(true, std::memory_order_release);
+    }).share();
+
+    return ClipHandle(slot);
+}
+
+std::size_t AssetManager::loadDirectory(const std::string& directory) {
+    std::vector<std::string> fileNames;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".bvh") {
+            fileNames.push_back(entry.path().generic_string());
+        }
+    }
+
+    loadClips(fileNames);
+
+    std::size_t loaded = 0;
+    for (const auto& fileName : fileNames) {
+        loaded += clip(fileName) != nullptr;
+    }
+    return loaded;
+}
+
+void AssetManager::loadClips(const std::vector<std::string>& fileNames) {
+    std::vector<ClipHandle> pending;
+    pending.reserve(fileNames.size());
+
+    for (const auto& fileName : fileNames) {
+        pending.push_back(request(fileName));
+    }
+
+    for (const auto& handle : pending) {
+        handle.wait();
+    }
+}
+
+std::shared_ptr<const BVH> AssetManager::clip(const std::string& fileName) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto found = clips.find(fileName);
+    if (found == clips.end() || !found->second->done.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return found->second->clip;
+}
+
+std::vector<std::string> AssetManager::clipNames() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    for (const auto& entry : clips) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+std::vector<std::pair<std::string, double>> AssetManager::loadLatencies() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<std::string, double>> latencies;
+    for (const auto& entry : clips) {
+        const ClipHandle handle(entry.second);
+        if (handle.ready()) {
+            latencies.emplace_back(entry.first, handle.latency());
+        }
+    }
+    return latencies;
+}
+
+AssetStats AssetManager::stats() const {
+    AssetStats result;
+    result.cacheHits = cacheHits.load();
+    result.cacheMisses = cacheMisses.load();
+
+    std::size_t completed = 0;
+    for (const auto& latency : loadLatencies()) {
+        result.meanLoadLatency += latency.second;
+        result.maxLoadLatency = std::max(result.maxLoadLatency, latency.second);
+        completed++;
+    }
+    if (completed > 0) {
+        result.meanLoadLatency /= completed;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : clips) {
+        if (!entry.second->done.load(std::memory_order_acquire)) {
+            result.clipsPending++;
+        } else if (entry.second->clip != nullptr) {
+            result.clipsLoaded++;
+        }
+    }
+    for (const auto& bucket : skeletons) {
+        result.uniqueSkeletons += bucket.second.size();
+    }
+    return result;
+}
+
+std::shared_ptr<const BVH> AssetManager::loadClip(const std::string& fileName,
+                                                  std::uint64_t& hash,
+                                                  std::string& problem) {
+    std::ifstream inFile(fileName, std::ios::binary);
+    if (!inFile) {
+        problem = "cannot be read";
+        return nullptr;
+    }
+
+    // the whole file is needed anyway to compute its content hash
+    std::ostringstream contents;
+    contents << inFile.rdbuf();
+    const std::string text = contents.str();
+    hash = contentHash(text);
+
+    std::shared_ptr<BVH> loaded = std::make_shared<BVH>();
+    const std::string cached = cachePath(hash, "clip");
+
+    if (!cached.empty() && loaded->readBinaryFile(cached.data())) {
+        cacheHits++;
+    } else {
+        cacheMisses++;
+
+        loaded = std::make_shared<BVH>();
+        std::istringstream textStream(text);
+        if (!loaded->readBVH(textStream)) {
+            problem = "cannot be parsed";
+            return nullptr;
+        }
+
+        if (!cached.empty()) {
+            // write under a unique name and rename, concurrent loaders never see a partial file
+            const std::string temporary = cached + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+            if (loaded->writeBinaryFile(temporary.data())) {
+                std::error_code error;
+                std::filesystem::rename(temporary, cached, error);
+            }
+            std::remove(temporary.data());
+        }
+    }
+
+    loaded->shareSkeleton(internSkeleton(loaded->skeleton));
+    return loaded;
+}
+
+std::shared_ptr<const Skeleton> AssetManager::internSkeleton(const std::shared_ptr<const Skeleton>& skeleton) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::shared_ptr<const Skeleton>>& bucket = skeletons[skeleton->hash];
+    for (const auto& candidate : bucket) {
+        if (candidate->sameAs(*skeleton)) {
+            return candidate;
+        }
+    }
+
+    bucket.push_back(skeleton);
+    return skeleton;
+}
+
+ThreadPool& AssetManager::workers() {
+    return pool;
+}
+
+std::string AssetManager::cachePath(const std::uint64_t hash, const char* extension) const {
+    if (cacheDirectory.empty()) {
+        return std::string();
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx.%s", static_cast<unsigned long long>(hash), extension);
+    return (std::filesystem::path(cacheDirectory) / name).generic_string();
+}
@@ -0,0 +1,143 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BVH.h"
+#include "ThreadPool.h"
+
+struct AssetStats {
+    std::size_t clipsLoaded = 0;
+    std::size_t clipsPending = 0;
+    std::size_t cacheHits = 0;
+    std::size_t cacheMisses = 0;
+    std::size_t uniqueSkeletons = 0;
+    // request-to-ready time over completed loads, in seconds
+    double meanLoadLatency = 0.0;
+    double maxLoadLatency = 0.0;
+};
+
+// Shared state of one requested clip, completed by a worker thread
+struct ClipSlot {
+    std::string name;
+    std::atomic<bool> done{false};
+    // written once before done is released, immutable afterwards
+    std::shared_ptr<const BVH> clip;
+    // why loading failed, written with clip
+    std::string problem;
+    // hash of the source file contents
+    std::uint64_t hash = 0;
+    std::chrono::steady_clock::time_point requested;
+    std::chrono::steady_clock::time_point completed;
+    std::shared_future<void> finished;
+};
+
+// Reference to a clip that may still be loading in the background
+class ClipHandle {
+public:
+    ClipHandle();
+
+    // true once loading finished, successfully or not
+    bool ready() const;
+
+    // nullptr while loading or if loading failed
+    // the clip is shared and read-only, any thread may sample it
+    const BVH* get() const;
+
+    // blocks until loading finished
+    const BVH* wait() const;
+
+    // true once loading finished without a clip
+    bool failed() const;
+
+    // why loading failed, empty while loading or once loaded
+    const std::string& problem() const;
+
+    // seconds from request to completion, negative while pending
+    double latency() const;
+
+    const std::string& name() const;
+
+    // hash of the source file contents, 0 while loading or if the file could not be read
+    std::uint64_t hash() const;
+
+private:
+    friend class AssetManager;
+
+    explicit ClipHandle(std::shared_ptr<ClipSlot> slot);
+
+    std::shared_ptr<ClipSlot> slot;
+};
+
+// Loads clips in parallel, shares identical skeletons and caches parsed clips on disk
+// Cache entries are keyed by the hash of the source file contents,
+// so an unchanged .bvh is never parsed twice
+class AssetManager {
+public:
+    // an empty cacheDirectory disables the disk cache
+    // threadCount 0 uses one thread per core
+    explicit AssetManager(std::string cacheDirectory = "cache", unsigned int threadCount = 0);
+
+    // starts loading fileName in the background, returns immediately
+    // requesting the same file again returns the same handle
+    ClipHandle request(const std::string& fileName);
+
+    // view of fileName, built as soon as the clip itself is loaded (see BVH::makeView)
+    // the view shares the clip's data, requesting the same view again returns the same handle
+    ClipHandle request(const std::string& fileName, const ClipView& view);
+
+    // loads every .bvh file in directory, returns the number of clips loaded
+    std::size_t loadDirectory(const std::string& directory);
+
+    // loads the given .bvh files in parallel and waits for all of them
+    void loadClips(const std::vector<std::string>& fileNames);
+
+    // nullptr when the clip was never requested, is still loading or failed to load
+    std::shared_ptr<const BVH> clip(const std::string& fileName) const;
+
+    std::vector<std::string> clipNames() const;
+
+    // (clip, seconds) for every completed load
+    std::vector<std::pair<std::string, double>> loadLatencies() const;
+
+    AssetStats stats() const;
+
+    // the loading threads, other loading work may share them
+    ThreadPool& workers();
+
+    // file in the cache directory for an asset with the given content hash
+    // empty when the disk cache is disabled
+    std::string cachePath(std::uint64_t hash, const char* extension) const;
+
+private:
+    // runs on a worker thread, hash receives the hash of the file contents
+    // problem receives why loading failed when nullptr is returned
+    std::shared_ptr<const BVH> loadClip(const std::string& fileName, std::uint64_t& hash, std::string& problem);
+
+    // returns the shared instance identical to skeleton, registering it if new
+    std::shared_ptr<const Skeleton> internSkeleton(const std::shared_ptr<const Skeleton>& skeleton);
+
+    std::string cacheDirectory;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<ClipSlot>> clips;
+    std::unordered_map<std::uint64_t, std::vector<std::shared_ptr<const Skeleton>>> skeletons;
+
+    std::atomic<std::size_t> cacheHits{0};
+    std::atomic<std::size_t> cacheMisses{0};
+
+    // last member, so workers are joined before the state they touch is destroyed
+    ThreadPool pool;
+};
+
+#endif
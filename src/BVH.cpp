@@ -5,6 +5,13 @@
 #include <fstream>
 #include <iomanip>
 #include <queue>
+#include <sstream>
+#include <stdexcept>
+
+#include "BinaryIO.h"
+
+#include "FrameArena.h"
+#include "MemoryTracker.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -20,45 +27,332 @@
 
 constexpr float CYLINDER_RADIUS = 0.2f;
 constexpr int CYLINDER_SLICES = 10;
+// slice boundaries and slice middles around the cylinder, computed at compile time
+constexpr int CYLINDER_RING_STEPS = 2 * CYLINDER_SLICES;
+constexpr RingTable<CYLINDER_RING_STEPS> CYLINDER_RING = makeRingTable<CYLINDER_RING_STEPS>();
+
+// identifies the binary clip format and its revision
+constexpr std::uint32_t BINARY_CLIP_MAGIC = 0x50494c43; // "CLIP"
+constexpr std::uint32_t BINARY_CLIP_VERSION = 1;
+// revision storing ClipEncoding::Quantized frames
+constexpr std::uint32_t BINARY_CLIP_QUANTIZED_VERSION = 2;
+
+// per channel of a quantized clip, value = minimum + step * stored, step 0 for constant channels
+struct QuantizedChannel {
+    float minimum;
+    float step;
+};
+
+static void writeQuantizedFrames(std::ostream& outStream, const std::vector<std::vector<float>>& frames,
+                                 const std::size_t channelCount) {
+    std::vector<QuantizedChannel> channels(channelCount, QuantizedChannel{0.0f, 0.0f});
+    for (size_t channel = 0; channel < channelCount; channel++) {
+        float minimum = frames.empty() ? 0.0f : frames[0][channel];
+        float maximum = minimum;
+        for (const auto& frame : frames) {
+            minimum = std::min(minimum, frame[channel]);
+            maximum = std::max(maximum, frame[channel]);
+        }
+        channels[channel] = QuantizedChannel{minimum, (maximum - minimum) / 65535.0f};
+    }
 
-float easeInOut(float t);
+    // frame by frame, only the channels that vary
+    std::vector<std::uint16_t> values;
+    values.reserve(frames.size() * channelCount);
+    for (const auto& frame : frames) {
+        for (size_t channel = 0; channel < channelCount; channel++) {
+            const QuantizedChannel& quantized = channels[channel];
+            if (quantized.step > 0.0f) {
+                const float stored = std::round((frame[channel] - quantized.minimum) / quantized.step);
+                values.push_back(static_cast<std::uint16_t>(std::clamp(stored, 0.0f, 65535.0f)));
+            }
+        }
+    }
 
-BVH::BVH(): root(), frameCount(0), frameTime(0) {
+    writeArray(outStream, channels);
+    writeArray(outStream, values);
+}
+
+static bool readQuantizedFrames(std::istream& inStream, std::vector<std::vector<float>>& frames,
+                                const std::size_t channelCount) {
+    std::vector<QuantizedChannel> channels;
+    std::vector<std::uint16_t> values;
+    if (!readArray(inStream, channels) || channels.size() != channelCount || !readArray(inStream, values)) {
+        return false;
+    }
+
+    const std::size_t varying = std::count_if(channels.begin(), channels.end(),
+                                              [](const QuantizedChannel& channel) { return channel.step > 0.0f; });
+    if (values.size() != varying * frames.size()) {
+        return false;
+    }
+
+    const std::uint16_t* value = values.data();
+    for (auto& frame : frames) {
+        frame.resize(channelCount);
+        for (size_t channel = 0; channel < channelCount; channel++) {
+            const QuantizedChannel& quantized = channels[channel];
+            frame[channel] = quantized.step > 0.0f ? quantized.minimum + quantized.step * *value++ : quantized.minimum;
+        }
+    }
+    return true;
+}
+
+BVH::BVH(): skeleton(std::make_shared<Skeleton>()), frameCount(0), frameTime(0), rangeFrames(0) {
 }
 
 // read .bvh file, basic recursive-descent parser
 bool BVH::readBVHFile(const char* fileName) {
     std::ifstream inFile(fileName);
-    if (inFile.bad()) {
+    if (!inFile) {
         return false;
     }
 
+    return readBVH(inFile);
+}
+
+bool BVH::readBVH(std::istream& inFile) {
+    MemoryScope memoryScope(MemorySubsystem::Parser);
+
     std::string line;
     std::vector<std::string> tokens;
+    std::shared_ptr<Skeleton> parsedSkeleton = std::make_shared<Skeleton>();
 
     // loop through the file one line at a time
-    while (std::getline(inFile, line) && line.size() != 0) {
-        splitString(line, tokens);
+    // std::stof and std::stoi throw on malformed numbers, which makes the whole file malformed
+    try {
+        while (std::getline(inFile, line) && line.size() != 0) {
+            splitString(line, tokens);
+
+            if (tokens[0] == "HIERARCHY") {
+                // if the first token is HIERARCHY, it is the logical structure of the character
+                newLine(inFile, tokens);
+                if (tokens.size() < 2 || !readHierarchy(inFile, tokens, parsedSkeleton->root, -1, *parsedSkeleton)) {
+                    return false;
+                }
+            } else if (tokens[0] == "MOTION") {
+                // otherwise, if the first token is MOTION, it is the animation data
+                if (!readMotion(inFile)) {
+                    return false;
+                }
+                break;
+            }
+        }
+    } catch (const std::logic_error&) {
+        return false;
+    }
+
+    if (parsedSkeleton->boneNames.empty()) {
+        return false;
+    }
+
+    parsedSkeleton->finalise();
+    this->skeleton = parsedSkeleton;
+    return loadAllData();
+}
+
+bool BVH::writeBinaryFile(const char* fileName, const ClipEncoding encoding) const {
+    // a view has no frames of its own
+    if (source != nullptr) {
+        return false;
+    }
+
+    std::ofstream outFile(fileName, std::ios::binary);
+    if (!outFile) {
+        return false;
+    }
+
+    const bool quantized = encoding == ClipEncoding::Quantized;
+    writeValue(outFile, BINARY_CLIP_MAGIC);
+    writeValue(outFile, quantized ? BINARY_CLIP_QUANTIZED_VERSION : BINARY_CLIP_VERSION);
+    skeleton->write(outFile);
+
+    writeValue(outFile, static_cast<std::uint32_t>(frames.size()));
+    writeValue(outFile, frameTime);
+    if (quantized) {
+        writeQuantizedFrames(outFile, frames, skeleton->frameChannels);
+    } else {
+        for (const auto& frame : frames) {
+            writeArray(outFile, frame);
+        }
+    }
+
+    return static_cast<bool>(outFile);
+}
+
+bool BVH::readBinaryFile(const char* fileName) {
+    MemoryScope memoryScope(MemorySubsystem::Parser);
+
+    std::ifstream inFile(fileName, std::ios::binary);
+    if (!inFile) {
+        return false;
+    }
+
+    std::uint32_t magic = 0, version = 0, storedFrames = 0;
+    if (!readValue(inFile, magic) || magic != BINARY_CLIP_MAGIC || !readValue(inFile, version) ||
+        (version != BINARY_CLIP_VERSION && version != BINARY_CLIP_QUANTIZED_VERSION)) {
+        return false;
+    }
+
+    std::shared_ptr<Skeleton> storedSkeleton = std::make_shared<Skeleton>();
+    if (!storedSkeleton->read(inFile) ||
+        !readValue(inFile, storedFrames) || storedFrames == 0 ||
+        !readValue(inFile, frameTime)) {
+        return false;
+    }
+
+    frames.resize(storedFrames);
+    if (version == BINARY_CLIP_QUANTIZED_VERSION) {
+        if (!readQuantizedFrames(inFile, frames, storedSkeleton->frameChannels)) {
+            return false;
+        }
+    } else {
+        for (auto& frame : frames) {
+            if (!readArray(inFile, frame)) {
+                return false;
+            }
+        }
+    }
+
+    this->skeleton = storedSkeleton;
+    this->frameCount = storedFrames;
+    return loadAllData();
+}
+
+bool BVH::validate(std::string& problem) const {
+    if (!skeleton->validate(problem)) {
+        return false;
+    }
+
+    if (frames.empty() || static_cast<int>(frames.size()) != frameCount) {
+        problem = std::to_string(frames.size()) + " frames where " + std::to_string(frameCount) + " are declared";
+        return false;
+    }
+    if (!(frameTime > 0.0f)) {
+        problem = "frame time is not positive";
+        return false;
+    }
+
+    for (size_t frame = 0; frame < frames.size(); frame++) {
+        if (frames[frame].size() != skeleton->frameChannels) {
+            problem = "frame " + std::to_string(frame) + " has " + std::to_string(frames[frame].size()) +
+                      " values for " + std::to_string(skeleton->frameChannels) + " channels";
+            return false;
+        }
+        for (const float value : frames[frame]) {
+            if (!std::isfinite(value)) {
+                problem = "frame " + std::to_string(frame) + " has a value that is not finite";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool BVH::bake(BVH& baked) const {
+    if (source != nullptr) {
+        return false;
+    }
+
+    std::shared_ptr<const Skeleton> bakedSkeleton = std::make_shared<const Skeleton>(skeleton->bakedChannels());
 
-        if (tokens[0] == "HIERARCHY") {
-            // if the first token is HIERARCHY, it is the logical structure of the character
-            newLine(inFile, tokens);
-            Joint joint;
-            readHierarchy(inFile, tokens, joint, -1);
-            this->root = joint;
-        } else if (tokens[0] == "MOTION") {
-            // otherwise, if the first token is MOTION, it is the animation data
-            readMotion(inFile);
-            break;
+    // decode through the original layouts, encode through the baked ones
+    std::vector<std::vector<float>> bakedFrames(frames.size(), std::vector<float>(bakedSkeleton->frameChannels));
+    std::vector<Cartesian3> frameRotations(skeleton->jointCount());
+    for (size_t frame = 0; frame < frames.size(); frame++) {
+        if (frames[frame].size() < skeleton->frameChannels) {
+            return false;
         }
+
+        Cartesian3 rootPosition;
+        decodeFrame(skeleton->channelLayouts, frames[frame].data(), frameRotations.data(), rootPosition);
+        encodeFrame(bakedSkeleton->channelLayouts, frameRotations.data(), rootPosition, bakedFrames[frame].data());
     }
 
-    setAllJoints(this->root, this->allJoints);
-    loadAllData();
+    return baked.setFrames(bakedSkeleton, std::move(bakedFrames), frameTime);
+}
+
+float BVH::frameDuration() const {
+    return frameTime;
+}
+
+void BVH::shareSkeleton(const std::shared_ptr<const Skeleton>& sharedSkeleton) {
+    skeleton = sharedSkeleton;
+}
+
+bool BVH::setFrames(const std::shared_ptr<const Skeleton>& skeleton,
+                    std::vector<std::vector<float>> frames,
+                    const float frameTime) {
+    this->source = nullptr;
+    this->skeleton = skeleton;
+    this->frames = std::move(frames);
+    this->frameTime = frameTime;
+    this->frameCount = this->frames.size();
+    return loadAllData();
+}
+
+bool BVH::makeView(const std::shared_ptr<const BVH>& source, const ClipView& view, std::string& problem) {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
+
+    // a view of a view would chain lookups, view its source instead
+    if (source == nullptr || source->source != nullptr) {
+        problem = "a view needs a loaded clip that is not a view itself";
+        return false;
+    }
+    if (view.rate <= 0.0f) {
+        problem = "the view's rate is not positive";
+        return false;
+    }
+    const int range = view.frameCount == 0 ? source->frameCount - view.firstFrame : view.frameCount;
+    if (view.firstFrame < 0 || range <= 0 || view.firstFrame + range > source->frameCount) {
+        const std::string frames = range <= 0 ? "frame " + std::to_string(view.firstFrame) + " is"
+                                              : "frames " + std::to_string(view.firstFrame) + " to " +
+                                                std::to_string(view.firstFrame + range - 1) + " are";
+        problem = frames + " not within the clip's " + std::to_string(source->frameCount) + " frames";
+        return false;
+    }
+
+    this->source = source;
+    this->view = view;
+    this->rangeFrames = range;
+    this->skeleton = source->skeleton;
+    this->frameTime = source->frameTime;
+    this->frames.clear();
+    this->boneRotations.clear();
+    this->rootPositions.clear();
+
+    // a ping-pong cycle does not repeat its end frames
+    const int cycle = view.loop == LoopMode::PingPong ? std::max(1, 2 * range - 2) : range;
+    this->frameCount = std::max(1, static_cast<int>(std::ceil(cycle / view.rate)));
+
+    const std::vector<Cartesian3> sourcePositions = source->rootMotionTrack.positions();
+
+    // mirrored travel is reflected across the model-space plane between the two sides
+    Cartesian3 side;
+    side[skeleton->mirrorAxis] = 1.0f;
+    const Cartesian3 normal = modelMatrix().transformVector(side);
+
+    std::vector<Cartesian3> rootPositions;
+    rootPositions.reserve(frameCount);
+    for (int frame = 0; frame < frameCount; frame++) {
+        const Cartesian3& position = sourcePositions[sourceFrame(frame)];
+        rootPositions.push_back(view.mirrored ? position - 2.0f * position.dot(normal) * normal : position);
+    }
+    rootMotionTrack.extract(rootPositions);
     return true;
 }
 
-void BVH::newLine(std::ifstream& inFile,
+int BVH::sourceFrame(const int frame) const {
+    const int played = static_cast<int>(frame * view.rate);
+    if (view.loop == LoopMode::PingPong && rangeFrames > 1) {
+        const int period = 2 * rangeFrames - 2;
+        const int step = played % period;
+        return view.firstFrame + (step < rangeFrames ? step : period - step);
+    }
+    return view.firstFrame + played % rangeFrames;
+}
+
+void BVH::newLine(std::istream& inFile,
                   std::vector<std::string>& tokens) {
     std::string line;
     tokens.clear();
@@ -84,15 +378,16 @@ bool BVH::isNumeric(const std::string& str) {
 }
 
 // recursive descent parser for the hierarchy
-void BVH::readHierarchy(std::ifstream& inFile,
+bool BVH::readHierarchy(std::istream& inFile,
                         std::vector<std::string>& line,
                         Joint& joint,
-                        const int parent) {
+                        const int parent,
+                        Skeleton& skeleton) {
     // the new joint will have the next available ID
-    joint.id = this->boneNames.size();
+    joint.id = skeleton.boneNames.size();
     joint.name = line[1];
-    this->boneNames.push_back(joint.name);
-    this->parentBones.push_back(parent);
+    skeleton.boneNames.push_back(joint.name);
+    skeleton.parentBones.push_back(parent);
 
     newLine(inFile, line);
     if (line[0] == "{") {
@@ -100,23 +395,36 @@ void BVH::readHierarchy(std::ifstream& inFile,
         // ignore the rest of the line and read in a new one
         newLine(inFile, line);
         while (line[0] != "}") {
+            // a file that ends before the group does is truncated
+            if (!inFile) {
+                return false;
+            }
+
             // until we hit the close of the group
             // The first token tells us which type of line
             if (line[0] == "OFFSET") {
                 // OFFSET is the offset from the parent
+                if (line.size() < 4) {
+                    return false;
+                }
                 joint.offset[0] = std::stof(line[1]);
                 joint.offset[1] = std::stof(line[2]);
                 joint.offset[2] = std::stof(line[3]);
             } else if (line[0] == "CHANNELS") {
                 // CHANNELS defines how many floats are needed for the animation, and
                 // which ones
+                if (line.size() < 2 || line.size() < static_cast<size_t>(std::stoi(line[1])) + 2) {
+                    return false;
+                }
                 for (int i = 0; i < std::stoi(line[1]); i++) {
                     joint.channels.push_back(line[i + 2]);
                 }
             } else if (line[0] == "JOINT") {
                 // JOINT defines a new joint
                 Joint child;
-                readHierarchy(inFile, line, child, joint.id);
+                if (line.size() < 2 || !readHierarchy(inFile, line, child, joint.id, skeleton)) {
+                    return false;
+                }
                 joint.children.push_back(child);
             } else if (line[0] == "End") {
                 // At the leaf of the hierarchy, there is no joint. Instead it says End
@@ -129,19 +437,26 @@ void BVH::readHierarchy(std::ifstream& inFile,
             newLine(inFile, line);
         }
     }
+    return true;
 }
 
 
-void BVH::readMotion(std::ifstream& inFile) {
+bool BVH::readMotion(std::istream& inFile) {
     std::string line;
     std::vector<std::string> tokens;
 
     // the next line should specify how many frames, so read it in
     newLine(inFile, tokens);
+    if (tokens.size() < 2) {
+        return false;
+    }
     this->frameCount = std::stoi(tokens[1]);
 
     // the next line should specify how many seconds per frame, so read it in
     newLine(inFile, tokens);
+    if (tokens.size() < 3) {
+        return false;
+    }
     this->frameTime = std::stof(tokens[2]);
 
     // after that, we loop until the end of the file
@@ -157,50 +472,127 @@ void BVH::readMotion(std::ifstream& inFile) {
         }
         this->frames.push_back(frame);
     }
+    return true;
 }
 
-void BVH::render(Matrix4& viewMatrix, const float scale, const int frame) {
+Affine3x4 BVH::modelMatrix() {
     /**
      * According to the specification: https://research.cs.wisc.edu/graphics/Courses/cs-838-1999/Jeff/BVH.html,
      * BVH follows a right-handed system with up = Y+. We need up = Z+ for rendering.
      * Apply rotationX(90) to map Y+ -> Z+. Consequently, this makes Z+ -> Y-.
      * Apply rotationZ(180) to map Y- -> Y+, thus making (0, 1, 0) forward.
      */
-    renderJoint(viewMatrix, Matrix4::rotationZ(180.0f) * Matrix4::rotationX(-90.0f), &root, scale, frame);
+    return Affine3x4::rotationZ(180.0f) * Affine3x4::rotationX(-90.0f);
 }
 
-void BVH::renderJoint(Matrix4& viewMatrix,
-                      const Matrix4& parentMatrix,
-                      Joint* joint,
-                      const float scale,
-                      const int frame) {
-    const Matrix4 translationMatrix = Matrix4::translation(scale * boneTranslations[joint->id]);
-    // This breaks if frame < 0, which happens when (max(int) + 1) frames are rendered
-    // Considered unlikely to occur for most animations
-    const int frameIndex = frame % frameCount;
-    const Cartesian3 rotation = boneRotations[frameIndex][joint->id];
-
+Affine3x4 BVH::localMatrix(const Cartesian3& scaledTranslation, const Cartesian3& rotation, const Precision precision) {
     /**
      * Negate rotations to make bones look well oriented, uncertain of the reason
      * Could be that the BVH rotations are CW but I couldn't find proof of it
      */
-    const Matrix4 rotationMatrix = Matrix4::rotationX(-rotation.x) *
-                                   Matrix4::rotationY(-rotation.y) *
-                                   Matrix4::rotationZ(-rotation.z);
+    float sx, cx, sy, cy, sz, cz;
+    sinCosDegrees(rotation.x, precision, sx, cx);
+    sinCosDegrees(rotation.y, precision, sy, cy);
+    sinCosDegrees(rotation.z, precision, sz, cz);
+
+    // translation * rotationX(-x) * rotationY(-y) * rotationZ(-z), multiplied out
+    Affine3x4 result;
+    result[0] = Vec4(cy * cz, -cy * sz, sy, scaledTranslation.x);
+    result[1] = Vec4(cx * sz + sx * sy * cz, cx * cz - sx * sy * sz, -sx * cy, scaledTranslation.y);
+    result[2] = Vec4(sx * sz - cx * sy * cz, sx * cz + cx * sy * sz, cx * cy, scaledTranslation.z);
+    return result;
+}
 
-    const Matrix4 jointMatrix = parentMatrix * translationMatrix * rotationMatrix;
-    Matrix4 jointViewMatrix = viewMatrix * jointMatrix;
+const Cartesian3* BVH::rotations(const int frame, Cartesian3* scratch) const {
+    // This breaks if frame < 0, which happens when (max(int) + 1) frames are rendered
+    // Considered unlikely to occur for most animations
+    if (source == nullptr) {
+        return boneRotations[frame % frameCount].data();
+    }
+
+    const Cartesian3* played = source->rotations(sourceFrame(frame % frameCount), scratch);
+    if (!view.mirrored) {
+        return played;
+    }
+
+    // every joint takes its counterpart's rotation reflected across the plane between the sides:
+    // turning about the axis the sides lie apart along is unchanged, the other two turn the other way
+    const std::vector<int>& mirrorJoints = skeleton->mirrorJoints;
+    const int axis = skeleton->mirrorAxis;
+    for (size_t joint = 0; joint < mirrorJoints.size(); joint++) {
+        const Cartesian3& rotation = played[mirrorJoints[joint]];
+        scratch[joint] = -rotation;
+        scratch[joint][axis] = rotation[axis];
+    }
+    return scratch;
+}
+
+Cartesian3 BVH::rootPosition(const int frame) const {
+    if (source == nullptr) {
+        return rootPositions[frame % frameCount];
+    }
+
+    // mirrored the same way as the view's root motion
+    Cartesian3 position = source->rootPosition(sourceFrame(frame % frameCount));
+    if (view.mirrored) {
+        position[skeleton->mirrorAxis] = -position[skeleton->mirrorAxis];
+    }
+    return position;
+}
+
+const RootMotionTrack& BVH::rootMotion() const {
+    return rootMotionTrack;
+}
+
+void BVH::render(const Matrix4& viewMatrix, const float scale, const int frame) const {
+    // joint transforms only live until the end of the tick, draw them from the frame arena
+    Affine3x4* jointMatrices = FrameArena::local().allocateArray<Affine3x4>(skeleton->jointCount());
+    computeJointMatrices(modelMatrix(), scale, frame, jointMatrices);
+
+    renderPose(*skeleton, viewMatrix, scale, jointMatrices);
+}
+
+void BVH::renderPose(const Skeleton& skeleton,
+                     const Matrix4& viewMatrix,
+                     const float scale,
+                     const Affine3x4* jointMatrices,
+                     const unsigned char* mask) {
+    const std::vector<Cartesian3>& boneTranslations = skeleton.boneTranslations;
+    const std::vector<int>& parentBones = skeleton.parentBones;
+
+    // every joint but the root ends a bone that starts at its parent
+    const size_t jointCount = boneTranslations.size();
+    for (size_t joint = 1; joint < jointCount; joint++) {
+        if (mask != nullptr && !mask[joint]) {
+            continue;
+        }
+
+        const Matrix4 parentViewMatrix = viewMatrix * jointMatrices[parentBones[joint]];
 
-    for (auto& childJoint : joint->children) {
         // Bone start in Bone Coordinate System is (0, 0, 0)
         // scale * (0, 0, 0) = (0, 0, 0) => Avoid scaling
         const Cartesian3 boneStart;
 
         // Bone end in Bone Coordinate System is scaled child joint translation
-        const Cartesian3 boneEnd = scale * boneTranslations[childJoint.id];
+        const Cartesian3 boneEnd = scale * boneTranslations[joint];
+
+        renderOrientedCylinder(parentViewMatrix, boneStart, boneEnd);
+    }
+}
 
-        renderOrientedCylinder(jointViewMatrix, boneStart, boneEnd);
-        renderJoint(viewMatrix, jointMatrix, &childJoint, scale, frame);
+void BVH::computeJointMatrices(const Affine3x4& rootMatrix,
+                               const float scale,
+                               const int frame,
+                               Affine3x4* jointMatrices) const {
+    const std::vector<Cartesian3>& boneTranslations = skeleton->boneTranslations;
+    Cartesian3* scratch = FrameArena::local().allocateArray<Cartesian3>(boneTranslations.size());
+    const Cartesian3* frameRotations = rotations(frame, scratch);
+    const std::vector<int>& parentBones = skeleton->parentBones;
+
+    // ids are assigned in depth-first order, so a parent is always computed before its children
+    for (size_t joint = 0; joint < boneTranslations.size(); joint++) {
+        const Affine3x4& parentMatrix = parentBones[joint] < 0 ? rootMatrix : jointMatrices[parentBones[joint]];
+        jointMatrices[joint] = parentMatrix * localMatrix(scale * boneTranslations[joint], frameRotations[joint]);
     }
 }
 
@@ -212,50 +604,45 @@ void BVH::renderOrientedCylinder(const Matrix4& viewMatrix,
     const Matrix4 cylinderViewMatrix =
             viewMatrix * Matrix4::rotateBetween(Cartesian3(0.0f, 0.0f, 1.0f), (end - start).unit());
 
-    renderCylinder(cylinderViewMatrix, CYLINDER_RADIUS, (end - start).length(), CYLINDER_SLICES);
+    renderCylinder(cylinderViewMatrix, CYLINDER_RADIUS, (end - start).length());
 }
 
 void BVH::renderCylinder(const Matrix4& viewMatrix,
                          const float radius,
-                         const float length,
-                         const int slices) {
+                         const float length) {
+    // the top and bottom vertices and normals are the same for every slice
+    const Homogeneous4 center_up = viewMatrix * Homogeneous4(0.0, 0.0, length, 1);
+    const Homogeneous4 center_bottom = viewMatrix * Homogeneous4(0.0, 0.0, 0, 1);
+
+    // normal vectors are tricky because we need to AVOID using the translation
+    // We can either use a triangle face normal, or we can do a hack ;-)
+    // because we know that they are from the origin to given points
+    const Cartesian3 origin = viewMatrix * Cartesian3(0.0, 0.0, 0.0);
+    const Cartesian3 normal_up = viewMatrix * Cartesian3(0, 0, 1.0) - origin;
+    const Cartesian3 normal_bottom = viewMatrix * Cartesian3(0, 0, -1.0) - origin;
+
     glBegin(GL_TRIANGLES);
 
-    for (int i = 0; i < slices; i++) {
-        // work out the angles around the main axis for the start and end of the slice
-        const float theta = i * 2.0f * M_PI / slices;
-        const float nextTheta = (i + 1) * 2.0f * M_PI / slices;
-        const float midTheta = 0.5f * (theta + nextTheta);
+    for (int i = 0; i < CYLINDER_SLICES; i++) {
+        // the angles around the main axis for the start, middle and end of the slice come from the ring table
+        const int theta = 2 * i;
+        const int midTheta = 2 * i + 1;
+        const int nextTheta = (2 * i + 2) % CYLINDER_RING_STEPS;
+        const float cosTheta = CYLINDER_RING.cosines[theta];
+        const float sinTheta = CYLINDER_RING.sines[theta];
+        const float cosNextTheta = CYLINDER_RING.cosines[nextTheta];
+        const float sinNextTheta = CYLINDER_RING.sines[nextTheta];
 
-        // the top vertex is always in the same place
-        Homogeneous4 center_up = viewMatrix * Homogeneous4(0.0, 0.0, length, 1);
         // we have two points on the upper circle of the cylinder
-        Homogeneous4 c_edge1 =
-                viewMatrix * Homogeneous4(radius * std::cos(theta), radius * std::sin(theta), length, 1);
-        Homogeneous4 c_edge2 =
-                viewMatrix * Homogeneous4(radius * std::cos(nextTheta), radius * std::sin(nextTheta), length, 1);
+        Homogeneous4 c_edge1 = viewMatrix * Homogeneous4(radius * cosTheta, radius * sinTheta, length, 1);
+        Homogeneous4 c_edge2 = viewMatrix * Homogeneous4(radius * cosNextTheta, radius * sinNextTheta, length, 1);
         // and two points on the bottom circle
-        Homogeneous4 c_edge3 =
-                viewMatrix * Homogeneous4(radius * std::cos(nextTheta), radius * std::sin(nextTheta), 0, 1);
-        Homogeneous4 c_edge4 = viewMatrix * Homogeneous4(radius * std::cos(theta),
-                                                         radius * std::sin(theta), 0, 1);
-        // and a point in the middle of the bottom
-        Homogeneous4 center_bottom = viewMatrix * Homogeneous4(0.0, 0.0, 0, 1);
-
-        // normal vectors are tricky because we need to AVOID using the translation
-        // We can either use a triangle face normal, or we can do a hack ;-)
-        // because we know that they are from the origin to given points
-
-        // we have three normals: one for the top
-        Cartesian3 normal_up = viewMatrix * Cartesian3(0, 0, 1.0) -
-                               viewMatrix * Cartesian3(0.0, 0.0, 0.0);
-        // one for the middle
+        Homogeneous4 c_edge3 = viewMatrix * Homogeneous4(radius * cosNextTheta, radius * sinNextTheta, 0, 1);
+        Homogeneous4 c_edge4 = viewMatrix * Homogeneous4(radius * cosTheta, radius * sinTheta, 0, 1);
+
+        // the side normal points out through the middle of the slice
         Cartesian3 normal_edge =
-                viewMatrix * Cartesian3(std::cos(midTheta), std::sin(midTheta), 0.0) -
-                viewMatrix * Cartesian3(0.0, 0.0, 0.0);
-        // and one for the bottom
-        Cartesian3 normal_bottom = viewMatrix * Cartesian3(0, 0, -1.0) -
-                                   viewMatrix * Cartesian3(0.0, 0.0, 0.0);
+                viewMatrix * Cartesian3(CYLINDER_RING.cosines[midTheta], CYLINDER_RING.sines[midTheta], 0.0) - origin;
 
         // render the top triangle
         glNormal3fv(&normal_up.x);
@@ -284,81 +671,38 @@ void BVH::renderCylinder(const Matrix4& viewMatrix,
     glEnd();
 }
 
-void BVH::setAllJoints(Joint& joint, std::vector<Joint*>& joint_list) {
-    joint_list.push_back(&joint);
-
-    if (joint.children.empty()) {
-        return;
-    }
-
-    for (auto& i : joint.children) {
-        setAllJoints(i, joint_list);
-    }
-}
-
 // load all rotation and translation data into this instance
-void BVH::loadAllData() {
-    for (const auto& frame : this->frames) {
-        std::vector<Cartesian3> frame_rotations;
-        loadRotationData(frame_rotations, frame);
-        this->boneRotations.push_back(frame_rotations);
-    }
+bool BVH::loadAllData() {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
 
-    for (const auto& joint : this->allJoints) {
-        float x = joint->offset[0];
-        float y = joint->offset[1];
-        float z = joint->offset[2];
-        boneTranslations.emplace_back(x, y, z);
+    // frames are indexed modulo frameCount, which must be the number actually read
+    if (frameCount <= 0 || frames.size() != static_cast<size_t>(frameCount)) {
+        return false;
     }
-}
 
-void BVH::loadRotationData(std::vector<Cartesian3>& rotations,
-                           const std::vector<float>& frames) {
-    for (size_t j = 0, j_c = 0; j < frames.size(); j_c++) {
-        float rotation[3] = {0, 0, 0};
-        for (size_t k = 0; k < this->allJoints[j_c]->channels.size(); k++) {
-            if (this->allJoints[j_c]->channels[k].substr(1) == "rotation") {
-                const int rotationIndex = bvhChannels[this->allJoints[j_c]->channels[k]];
-                rotation[rotationIndex - 3] = frames[j + k];
-            }
+    const std::vector<JointChannelLayout>& layouts = skeleton->channelLayouts;
+    const Affine3x4 toModel = modelMatrix();
+
+    boneRotations.clear();
+    boneRotations.reserve(frames.size());
+    rootPositions.clear();
+    rootPositions.reserve(frames.size());
+    std::vector<Cartesian3> modelPositions;
+    modelPositions.reserve(frames.size());
+    for (const auto& frame : frames) {
+        // a short frame would leave joints without a rotation
+        if (frame.size() < skeleton->frameChannels) {
+            return false;
         }
 
-        rotations.emplace_back(rotation[0], rotation[1], rotation[2]);
-        j += this->allJoints[j_c]->channels.size();
-    }
-}
-
-BVH* BVH::blend(const int frame, const BVH& target) const {
-    BVH* blend = new BVH();
-
-    // Hard-assumption: blend over 0.5s => 0.5s * 24 f/s = 12 frames
-    blend->frameCount = 12;
-    // Retain reusable properties
-    blend->frameTime = this->frameTime;
-    blend->root = this->root;
-    blend->allJoints = this->allJoints;
-    blend->parentBones = this->parentBones;
-    blend->boneTranslations = this->boneTranslations;
-    // Avoid initialsing blend->frames as the property unused in this codebase
-
-    // Interpolate current frame againts first frame of target animation
-    const std::vector<Cartesian3> frameRotations = this->boneRotations[frame % this->frameCount];
-    const std::vector<Cartesian3> targetRotations = target.boneRotations[0];
-    blend->boneRotations.resize(blend->frameCount, std::vector<Cartesian3>());
-    for (unsigned int f = 0; f < blend->frameCount; f++) {
-        const float t = easeInOut(f / static_cast<float>(blend->frameCount));
-
-        for (unsigned int i = 0; i < frameRotations.size(); i++) {
-            Cartesian3 interpolatedRotation = (1.0f - t) * frameRotations[i] + t * targetRotations[i];
-
-            blend->boneRotations[f].push_back(interpolatedRotation);
-        }
+        std::vector<Cartesian3> frameRotations(layouts.size());
+        Cartesian3 rootPosition;
+        decodeFrame(layouts, frame.data(), frameRotations.data(), rootPosition);
+        boneRotations.push_back(std::move(frameRotations));
+        rootPositions.push_back(rootPosition);
+        modelPositions.push_back(toModel.transformPoint(rootPosition));
     }
 
-    return blend;
-}
-
-float easeInOut(const float t) {
-    const float sqt = t * t;
-    return sqt / (2.0f * (sqt - t) + 1.0f);
+    rootMotionTrack.extract(modelPositions);
+    return true;
 }
@@ -1,61 +1,115 @@
 #ifndef BVH_H
 #define BVH_H
 
-#include <array>
+#include <iostream>
+#include <memory>
 #include <vector>
 #include <string>
-#include <map>
 
+#include "Affine3x4.h"
 #include "Cartesian3.h"
+#include "ClipView.h"
 #include "Matrix4.h"
-
-class Joint {
-public:
-    // index of Joint
-    int id;
-    std::string name;
-    std::array<float, 3> offset{0.0f, 0.0f, 0.0f};
-    std::vector<std::string> channels;
-    std::vector<Joint> children;
+#include "RootMotion.h"
+#include "Skeleton.h"
+
+// frames a transition lasts unless told otherwise, 0.5s at 24 f/s
+constexpr int DEFAULT_BLEND_FRAMES = 12;
+
+// how writeBinaryFile stores channel values
+enum class ClipEncoding {
+    // floats as decoded, what the asset cache uses
+    Raw,
+    // 16 bits per value over each channel's range, constant channels stored once
+    // within 0.003 degrees for rotations and range / 131070 for positions
+    Quantized
 };
 
 // Biovision hierarchical data
 // https://research.cs.wisc.edu/graphics/Courses/cs-838-1999/Jeff/BVH.html
+// A loaded clip is immutable, const members only read it and any number of threads may sample it without locking
+// Shared clips are handed out as std::shared_ptr<const BVH> (see AssetManager), playback state such as the
+// current frame and evaluated joint transforms lives with each user (see PoseEvaluator)
+// A clip may also be a view of another one (see makeView), which plays the other clip's frames without copying them
 class BVH {
 public:
-    Joint root;
+    // immutable once loaded, clips recorded on identical hierarchies may share it
+    std::shared_ptr<const Skeleton> skeleton;
 
     int frameCount;
 
+    // seconds between frames
+    float frameDuration() const;
+
     // constructor
     BVH();
 
     // render bvh animation by given a sequence of frames data
-    void render(Matrix4& viewMatrix, float scale, int frame);
+    void render(const Matrix4& viewMatrix, float scale, int frame) const;
+
+    // render the bones of skeleton from joint transforms already evaluated for it, see PoseEvaluator
+    // bones ending in a joint outside mask are skipped
+    // only reads the skeleton, so it can draw poses evaluated on another thread
+    static void renderPose(const Skeleton& skeleton, const Matrix4& viewMatrix, float scale,
+                           const Affine3x4* jointMatrices, const unsigned char* mask = nullptr);
+
+    // local joint rotations (degrees) of a frame, wrapping around the clip, one per joint
+    // points into the clip's storage, or into scratch (room for one rotation per joint) for views that have to
+    // compute them, so it stays valid while the clip and scratch do
+    const Cartesian3* rotations(int frame, Cartesian3* scratch) const;
+
+    // horizontal travel of the root, extracted once at load time
+    const RootMotionTrack& rootMotion() const;
+
+    // root position of a frame as recorded, in BVH space and unscaled, wrapping around the clip
+    Cartesian3 rootPosition(int frame) const;
+
+    // maps the BVH Y-up space into the Z-up, Y-forward model space
+    static Affine3x4 modelMatrix();
+
+    // joint transform relative to its parent
+    static Affine3x4 localMatrix(const Cartesian3& scaledTranslation, const Cartesian3& rotation,
+                                 Precision precision = Precision::Exact);
 
     // Routines for file I/O
     // read data from bvh file
     bool readBVHFile(const char* fileName);
 
-    // creates a BVH that represents the blend of this into target
-    BVH* blend(int frame, const BVH& target) const;
+    // parse .bvh text from any stream, false when it is truncated or malformed, or holds no frames or not as many
+    // as it declares
+    bool readBVH(std::istream& inStream);
 
-private:
-    std::map<std::string, int> bvhChannels{
-        {"Xposition", 0},
-        {"Yposition", 1},
-        {"Zposition", 2},
-        {"Xrotation", 3},
-        {"Yrotation", 4},
-        {"Zrotation", 5}
-    };
+    // binary clip format: skeleton and channel data, no text parsing on load
+    bool writeBinaryFile(const char* fileName, ClipEncoding encoding = ClipEncoding::Raw) const;
 
-    float frameTime;
+    // reads either encoding
+    bool readBinaryFile(const char* fileName);
+
+    // false, with the first problem found, when the skeleton does not validate (see Skeleton::validate),
+    // the number of frames is not the one declared, a frame's length does not match the channels,
+    // a value is not finite or the frame time is not positive
+    bool validate(std::string& problem) const;
 
-    std::vector<std::string> boneNames;
-    std::vector<Joint*> allJoints;
-    // id -> parent id
-    std::vector<int> parentBones;
+    // copies the clip into baked, on the skeleton's bakedChannels
+    // every frame is rewritten in X, Y, Z order, so loading baked never converts rotation orders
+    // false for views
+    bool bake(BVH& baked) const;
+
+    // replace the skeleton by an identical instance shared with other clips
+    void shareSkeleton(const std::shared_ptr<const Skeleton>& sharedSkeleton);
+
+    // replaces the clip by frames recorded on skeleton, laid out as its channels, e.g. produced by a Retargeter
+    // false when a frame has fewer values than the skeleton has channels
+    bool setFrames(const std::shared_ptr<const Skeleton>& skeleton, std::vector<std::vector<float>> frames,
+                   float frameTime);
+
+    // turns this clip into view of source, which it keeps alive and reads its rotations from
+    // only the root motion, two floats a frame, is rebuilt for the view
+    // false, with the reason in problem, when source is itself a view or the view's range does not fit in it
+    bool makeView(const std::shared_ptr<const BVH>& source, const ClipView& view, std::string& problem);
+
+private:
+    float frameTime;
 
     // a vector to store all frames of the animation
     // this is *JUST* a huge 2D array of floats
@@ -63,33 +117,47 @@ private:
     // listed in strict numerical order
     std::vector<std::vector<float>> frames;
 
-    std::vector<Cartesian3> boneTranslations;
     std::vector<std::vector<Cartesian3>> boneRotations;
 
-    static void newLine(std::ifstream&, std::vector<std::string>&);
+    RootMotionTrack rootMotionTrack;
 
-    static void splitString(const std::string&, std::vector<std::string>&);
+    // root position of every frame as decoded, empty for views
+    std::vector<Cartesian3> rootPositions;
+
+    // the clip a view plays, nullptr for clips with their own frames
+    std::shared_ptr<const BVH> source;
+    ClipView view;
+    // frames in the view's range of source
+    int rangeFrames;
+
+    // frame of source shown at a frame of the view in [0, frameCount)
+    int sourceFrame(int frame) const;
 
-    void readHierarchy(std::ifstream&, std::vector<std::string>&, Joint&, int parent);
+    static void newLine(std::istream&, std::vector<std::string>&);
 
-    void readMotion(std::ifstream&);
+    static void splitString(const std::string&, std::vector<std::string>&);
+
+    // false when the file ends inside the hierarchy or a line is missing values
+    static bool readHierarchy(std::istream&, std::vector<std::string>&, Joint&, int parent, Skeleton&);
 
-    // load all rotation and translation data into this class
-    void loadAllData();
+    // false when the frame count or frame time is missing
+    bool readMotion(std::istream&);
 
-    void loadRotationData(std::vector<Cartesian3>& rotations, const std::vector<float>& frames);
+    // decode every frame through the skeleton's channel layouts into local rotations and root motion
+    // false when there are no frames, their number is not frameCount or a frame has fewer values than the
+    // skeleton has channels
+    bool loadAllData();
 
     static bool isNumeric(const std::string&);
 
-    // render a single joint by given frame index
-    void renderJoint(Matrix4& viewMatrix, const Matrix4& parentMatrix, Joint* joint, float scale, int frame);
+    // compute the transform of every joint in id order, parents before children
+    void computeJointMatrices(const Affine3x4& rootMatrix, float scale, int frame, Affine3x4* jointMatrices) const;
 
     // render cylinder given the start position and the end position
     static void renderOrientedCylinder(const Matrix4& viewMatrix, const Cartesian3& start, const Cartesian3& end);
 
-    static void renderCylinder(const Matrix4& viewMatrix, float radius, float length, int slices);
-
-    static void setAllJoints(Joint&, std::vector<Joint*>&);
+    // CYLINDER_SLICES slices around the axis
+    static void renderCylinder(const Matrix4& viewMatrix, float radius, float length);
 };
 
 #endif
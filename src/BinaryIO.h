@@ -0,0 +1,54 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Raw native-endian helpers for the binary asset formats
+
+template<typename T>
+void writeValue(std::ostream& outStream, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be written raw");
+    outStream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::istream& inStream, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be read raw");
+    return static_cast<bool>(inStream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template<typename T>
+void writeArray(std::ostream& outStream, const std::vector<T>& values) {
+    writeValue(outStream, static_cast<std::uint32_t>(values.size()));
+    outStream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+bool readArray(std::istream& inStream, std::vector<T>& values) {
+    std::uint32_t size = 0;
+    if (!readValue(inStream, size)) {
+        return false;
+    }
+    values.resize(size);
+    return static_cast<bool>(inStream.read(reinterpret_cast<char*>(values.data()), size * sizeof(T)));
+}
+
+inline void writeString(std::ostream& outStream, const std::string& value) {
+    writeValue(outStream, static_cast<std::uint32_t>(value.size()));
+    outStream.write(value.data(), value.size());
+}
+
+inline bool readString(std::istream& inStream, std::string& value) {
+    std::uint32_t size = 0;
+    if (!readValue(inStream, size)) {
+        return false;
+    }
+    value.resize(size);
+    return static_cast<bool>(inStream.read(&value[0], size));
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "ChannelLayout.h"
+
+#include <algorithm>
+#include <cmath>
+
+// axes of each RotationOrder, in the order they are composed
+constexpr int ORDER_AXES[ROTATION_ORDERS][3] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+using ChannelDecoder = void (*)(const JointChannelLayout& layout, const float* values,
+                                Cartesian3& position, Cartesian3& rotation);
+
+int channelIndex(const std::string& channel) {
+    static const char* channelNames[] = {"Xposition", "Yposition", "Zposition", "Xrotation", "Yrotation", "Zrotation"};
+
+    for (int index = 0; index < 6; index++) {
+        if (channel == channelNames[index]) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+JointChannelLayout compileChannelLayout(const std::vector<std::string>& channels, const std::uint32_t offset) {
+    JointChannelLayout layout;
+    layout.offset = offset;
+    layout.count = static_cast<std::uint8_t>(channels.size());
+
+    int axes[3];
+    int axisCount = 0;
+    for (size_t k = 0; k < channels.size(); k++) {
+        const int channel = channelIndex(channels[k]);
+        if (channel < 0) {
+            continue;
+        }
+
+        if (channel < 3) {
+            layout.position[channel] = static_cast<std::int8_t>(k);
+            layout.flags |= HAS_POSITION;
+            continue;
+        }
+
+        const int axis = channel - 3;
+        if (layout.rotation[axis] < 0) {
+            axes[axisCount++] = axis;
+        }
+        layout.rotation[axis] = static_cast<std::int8_t>(k);
+        layout.flags |= HAS_ROTATION;
+    }
+
+    // missing axes are left at 0 degrees, so where they go in the order makes no difference
+    for (int axis = 0; axis < 3; axis++) {
+        if (layout.rotation[axis] < 0) {
+            axes[axisCount++] = axis;
+        }
+    }
+    for (int order = 0; order < ROTATION_ORDERS; order++) {
+        if (ORDER_AXES[order][0] == axes[0] && ORDER_AXES[order][1] == axes[1]) {
+            layout.order = static_cast<RotationOrder>(order);
+        }
+    }
+
+    // the specialised decoders expect their channels packed, positions first and in X, Y, Z order
+    bool packedRotation = true;
+    for (int k = 0; k < 3; k++) {
+        packedRotation = packedRotation && layout.rotation[axes[k]] == layout.count - 3 + k;
+    }
+    const bool packedPosition = layout.position[0] == 0 && layout.position[1] == 1 && layout.position[2] == 2;
+    if (layout.count == 3 && packedRotation) {
+        layout.kind = ChannelLayoutKind::Rotation3;
+    } else if (layout.count == 6 && packedPosition && packedRotation) {
+        layout.kind = ChannelLayoutKind::Position3Rotation3;
+    }
+
+    return layout;
+}
+
+// 3x3 rotation by degrees about axis, for column vectors
+static void axisRotation(const int axis, const double degrees, double rotation[3][3]) {
+    const double radians = M_PI * degrees / 180.0;
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    const int a = (axis + 1) % 3;
+    const int b = (axis + 2) % 3;
+
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            rotation[row][column] = row == column ? 1.0 : 0.0;
+        }
+    }
+    rotation[a][a] = c;
+    rotation[a][b] = -s;
+    rotation[b][a] = s;
+    rotation[b][b] = c;
+}
+
+static void multiply(const double left[3][3], const double right[3][3], double result[3][3]) {
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            result[row][column] =
+                    left[row][0] * right[0][column] + left[row][1] * right[1][column] + left[row][2] * right[2][column];
+        }
+    }
+}
+
+void eulerToMatrix(const RotationOrder order, const Cartesian3& angles, double matrix[3][3]) {
+    const int* axes = ORDER_AXES[static_cast<int>(order)];
+    double first[3][3], second[3][3], third[3][3], partial[3][3];
+    axisRotation(axes[0], angles[axes[0]], first);
+    axisRotation(axes[1], angles[axes[1]], second);
+    axisRotation(axes[2], angles[axes[2]], third);
+    multiply(first, second, partial);
+    multiply(partial, third, matrix);
+}
+
+Cartesian3 matrixToEuler(const RotationOrder order, const double matrix[3][3], const Cartesian3& near) {
+    // for m = Ri Rj Rk, sin of the middle angle sits at m[i][k], signed by whether i, j, k is a cyclic order
+    // the outer angles follow from the rest of row i and column k
+    // when the middle angle is +-90 degrees only their sum or difference is defined, the last one is taken as 0
+    const int* axes = ORDER_AXES[static_cast<int>(order)];
+    const int i = axes[0], j = axes[1], k = axes[2];
+    const double sign = (j == (i + 1) % 3) ? 1.0 : -1.0;
+
+    double outer, middle, inner;
+    if (std::fabs(matrix[i][k]) < 1.0 - 1e-9) {
+        middle = std::asin(sign * matrix[i][k]);
+        outer = std::atan2(-sign * matrix[j][k], matrix[k][k]);
+        inner = std::atan2(-sign * matrix[i][j], matrix[i][i]);
+    } else {
+        middle = std::copysign(M_PI / 2.0, sign * matrix[i][k]);
+        outer = std::atan2(sign * matrix[k][j], matrix[j][j]);
+        inner = 0.0;
+    }
+
+    Cartesian3 result;
+    result[i] = static_cast<float>(180.0 * outer / M_PI);
+    result[j] = static_cast<float>(180.0 * middle / M_PI);
+    result[k] = static_cast<float>(180.0 * inner / M_PI);
+    for (int axis = 0; axis < 3; axis++) {
+        result[axis] += 360.0f * std::round((near[axis] - result[axis]) / 360.0f);
+    }
+    return result;
+}
+
+Cartesian3 toRotationXYZ(const RotationOrder order, const Cartesian3& angles) {
+    double matrix[3][3];
+    eulerToMatrix(order, angles, matrix);
+    return matrixToEuler(RotationOrder::XYZ, matrix, angles);
+}
+
+// the rotation channels starting at values, composed in Order
+template <RotationOrder Order>
+static Cartesian3 orderedRotation(const float* values) {
+    if constexpr (Order == RotationOrder::XYZ) {
+        return Cartesian3(values[0], values[1], values[2]);
+    } else {
+        constexpr const int* axes = ORDER_AXES[static_cast<int>(Order)];
+        Cartesian3 angles;
+        angles[axes[0]] = values[0];
+        angles[axes[1]] = values[1];
+        angles[axes[2]] = values[2];
+        return toRotationXYZ(Order, angles);
+    }
+}
+
+// three rotation channels
+template <RotationOrder Order>
+static void decodeRotation3(const JointChannelLayout&, const float* values, Cartesian3&, Cartesian3& rotation) {
+    rotation = orderedRotation<Order>(values);
+}
+
+// X, Y, Z position followed by three rotation channels, the usual root
+template <RotationOrder Order>
+static void decodePosition3Rotation3(const JointChannelLayout&,
+                                     const float* values,
+                                     Cartesian3& position,
+                                     Cartesian3& rotation) {
+    position = Cartesian3(values[0], values[1], values[2]);
+    rotation = orderedRotation<Order>(values + 3);
+}
+
+// any other layout, through the offsets in the descriptor
+static void decodeGeneric(const JointChannelLayout& layout,
+                          const float* values,
+                          Cartesian3& position,
+                          Cartesian3& rotation) {
+    Cartesian3 angles;
+    for (int axis = 0; axis < 3; axis++) {
+        if (layout.position[axis] >= 0) {
+            position[axis] = values[layout.position[axis]];
+        }
+        if (layout.rotation[axis] >= 0) {
+            angles[axis] = values[layout.rotation[axis]];
+        }
+    }
+
+    rotation = layout.order == RotationOrder::XYZ ? angles : toRotationXYZ(layout.order, angles);
+}
+
+#define CHANNEL_DECODERS(decoder) \
+    {decoder<RotationOrder::XYZ>, decoder<RotationOrder::XZY>, decoder<RotationOrder::YXZ>, \
+     decoder<RotationOrder::YZX>, decoder<RotationOrder::ZXY>, decoder<RotationOrder::ZYX>}
+
+// indexed by ChannelLayoutKind and RotationOrder
+static const ChannelDecoder DECODERS[CHANNEL_LAYOUT_KINDS][ROTATION_ORDERS] = {
+    {decodeGeneric, decodeGeneric, decodeGeneric, decodeGeneric, decodeGeneric, decodeGeneric},
+    CHANNEL_DECODERS(decodeRotation3),
+    CHANNEL_DECODERS(decodePosition3Rotation3)
+};
+
+#undef CHANNEL_DECODERS
+
+void encodeFrame(const std::vector<JointChannelLayout>& layouts,
+                 const Cartesian3* rotations,
+                 const Cartesian3& rootPosition,
+                 float* frame) {
+    for (size_t joint = 0; joint < layouts.size(); joint++) {
+        const JointChannelLayout& layout = layouts[joint];
+        float* values = frame + layout.offset;
+        std::fill(values, values + layout.count, 0.0f);
+
+        Cartesian3 angles = rotations[joint];
+        if (layout.order != RotationOrder::XYZ) {
+            double matrix[3][3];
+            eulerToMatrix(RotationOrder::XYZ, angles, matrix);
+            angles = matrixToEuler(layout.order, matrix, angles);
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (joint == 0 && layout.position[axis] >= 0) {
+                values[layout.position[axis]] = rootPosition[axis];
+            }
+            if (layout.rotation[axis] >= 0) {
+                values[layout.rotation[axis]] = angles[axis];
+            }
+        }
+    }
+}
+
+void decodeFrame(const std::vector<JointChannelLayout>& layouts,
+                 const float* frame,
+                 Cartesian3* rotations,
+                 Cartesian3& rootPosition) {
+    if (layouts.empty()) {
+        return;
+    }
+
+    // only the root's position is kept, other joints' positions land in scratch
+    const JointChannelLayout& root = layouts[0];
+    rootPosition = Cartesian3();
+    DECODERS[static_cast<int>(root.kind)][static_cast<int>(root.order)](root, frame + root.offset,
+                                                                         rootPosition, rotations[0]);
+
+    Cartesian3 scratch;
+    for (size_t joint = 1; joint < layouts.size(); joint++) {
+        const JointChannelLayout& layout = layouts[joint];
+        DECODERS[static_cast<int>(layout.kind)][static_cast<int>(layout.order)](layout, frame + layout.offset,
+                                                                             scratch, rotations[joint]);
+    }
+}
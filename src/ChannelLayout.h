@@ -0,0 +1,69 @@
+#ifndef CHANNEL_LAYOUT_H
+#define CHANNEL_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Cartesian3.h"
+
+// order of a joint's rotation channels, which is also the order BVH composes them in
+// XYZ is what BVH::localMatrix builds, every other order is converted to it when decoded
+enum class RotationOrder : std::uint8_t {
+    XYZ, XZY, YXZ, YZX, ZXY, ZYX
+};
+
+constexpr int ROTATION_ORDERS = 6;
+
+// layouts with a decoder of their own, anything else goes through the generic one
+enum class ChannelLayoutKind : std::uint8_t {
+    Generic, Rotation3, Position3Rotation3
+};
+
+constexpr int CHANNEL_LAYOUT_KINDS = 3;
+
+constexpr std::uint8_t HAS_POSITION = 1;
+constexpr std::uint8_t HAS_ROTATION = 2;
+
+// Channel names of a joint compiled into integers once, when its skeleton is finalised
+// Decoding a frame then never looks at a string
+struct JointChannelLayout {
+    // index of the joint's first value within a frame
+    std::uint32_t offset = 0;
+    std::uint8_t count = 0;
+    // HAS_POSITION and HAS_ROTATION
+    std::uint8_t flags = 0;
+    // per axis, index of its value relative to offset, -1 when the joint has no such channel
+    std::int8_t position[3] = {-1, -1, -1};
+    std::int8_t rotation[3] = {-1, -1, -1};
+    RotationOrder order = RotationOrder::XYZ;
+    ChannelLayoutKind kind = ChannelLayoutKind::Generic;
+};
+
+// 0-2 for X, Y, Z position and 3-5 for X, Y, Z rotation, -1 for unknown channels
+int channelIndex(const std::string& channel);
+
+// layout of channels, whose values start at offset within a frame
+JointChannelLayout compileChannelLayout(const std::vector<std::string>& channels, std::uint32_t offset);
+
+// local rotation (degrees, composed X, Y, Z) of every joint and the root position of one frame
+// frame holds the values of every layout, layouts[0] is the root
+void decodeFrame(const std::vector<JointChannelLayout>& layouts, const float* frame,
+                 Cartesian3* rotations, Cartesian3& rootPosition);
+
+// the reverse of decodeFrame, writes every channel of layouts into frame
+// rotations are converted to each joint's order, position channels of joints other than the root are written as 0
+void encodeFrame(const std::vector<JointChannelLayout>& layouts, const Cartesian3* rotations,
+                 const Cartesian3& rootPosition, float* frame);
+
+// x, y and z angles (degrees) composing X, Y, Z to the same rotation as angles composed in order
+// results are kept within half a turn of angles, so smooth curves stay smooth
+Cartesian3 toRotationXYZ(RotationOrder order, const Cartesian3& angles);
+
+// 3x3 rotation, for column vectors, of x, y and z angles (degrees) composed in order
+void eulerToMatrix(RotationOrder order, const Cartesian3& angles, double matrix[3][3]);
+
+// x, y and z angles (degrees) composing in order to matrix, each kept within half a turn of near
+Cartesian3 matrixToEuler(RotationOrder order, const double matrix[3][3], const Cartesian3& near);
+
+#endif
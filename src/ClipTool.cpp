@@ -0,0 +1,203 @@
+#include "ClipTool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <mutex>
+#include <utility>
+
+#include "Terrain.h"
+
+using Clock = std::chrono::steady_clock;
+
+// milliseconds since start
+static double millisecondsSince(const Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static std::size_t fileSize(const std::string& fileName) {
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(fileName, error);
+    return error ? 0 : static_cast<std::size_t>(size);
+}
+
+ClipTool::ClipTool(ClipToolOptions options): options(std::move(options)) {
+    if (this->options.retargetTarget != nullptr) {
+        retargeters = std::make_unique<RetargeterCache>(this->options.retargetTarget);
+    }
+}
+
+std::vector<std::string> ClipTool::findInputs(const std::string& directory) {
+    std::vector<std::string> fileNames;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator entry(directory, error), end; !error && entry != end;
+         entry.increment(error)) {
+        const std::string extension = entry->path().extension().generic_string();
+        if (entry->is_regular_file() && (extension == ".bvh" || extension == ".dem")) {
+            fileNames.push_back(entry->path().generic_string());
+        }
+    }
+
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+ClipToolResult ClipTool::process(const std::string& fileName, const std::string& inputDirectory) {
+    ClipToolResult result;
+    result.fileName = std::filesystem::path(fileName).lexically_relative(inputDirectory).generic_string();
+    result.inputBytes = fileSize(fileName);
+
+    const bool terrain = std::filesystem::path(fileName).extension() == ".dem";
+    std::filesystem::path outputPath = std::filesystem::path(options.outputDirectory) / result.fileName;
+    outputPath.replace_extension(terrain ? ".terrain" : ".clip");
+
+    std::error_code error;
+    std::filesystem::create_directories(outputPath.parent_path(), error);
+    if (error) {
+        result.problem = "cannot create " + outputPath.parent_path().generic_string();
+        return result;
+    }
+
+    // the parsers report malformed files themselves, this catches running out of memory on absurd sizes
+    try {
+        const std::string outputName = outputPath.generic_string();
+        result.succeeded = terrain ? processTerrain(fileName, outputName, result)
+                                   : processClip(fileName, outputName, result);
+    } catch (const std::exception& exception) {
+        result.problem = std::string("cannot be processed, ") + exception.what();
+    }
+
+    if (result.succeeded) {
+        result.outputBytes = fileSize(outputPath.generic_string());
+    }
+    return result;
+}
+
+bool ClipTool::processClip(const std::string& fileName, const std::string& outputName, ClipToolResult& result) {
+    Clock::time_point start = Clock::now();
+    std::unique_ptr<BVH> clip = std::make_unique<BVH>();
+    const bool parsed = clip->readBVHFile(fileName.data());
+    result.parseTime = millisecondsSince(start);
+    if (!parsed) {
+        result.problem = "cannot be parsed";
+        return false;
+    }
+
+    start = Clock::now();
+    const bool valid = clip->validate(result.problem);
+    result.validateTime = millisecondsSince(start);
+    if (!valid) {
+        return false;
+    }
+    result.frames = clip->frameCount;
+
+    start = Clock::now();
+    if (retargeters != nullptr) {
+        const std::shared_ptr<const Retargeter> retargeter = retargeters->find(clip->skeleton);
+        std::unique_ptr<BVH> retargeted = std::make_unique<BVH>();
+        if (retargeter == nullptr || !retargeter->retarget(*clip, *retargeted)) {
+            result.problem = "cannot be retargeted, its root does not match the target's";
+            return false;
+        }
+        clip = std::move(retargeted);
+    }
+    if (options.bake) {
+        std::unique_ptr<BVH> baked = std::make_unique<BVH>();
+        if (!clip->bake(*baked)) {
+            result.problem = "cannot be baked";
+            return false;
+        }
+        clip = std::move(baked);
+    }
+    result.bakeTime = millisecondsSince(start);
+
+    start = Clock::now();
+    const bool written = clip->writeBinaryFile(outputName.data(), options.encoding);
+    result.writeTime = millisecondsSince(start);
+    if (!written) {
+        result.problem = "cannot write " + outputName;
+    }
+    return written;
+}
+
+bool ClipTool::processTerrain(const std::string& fileName, const std::string& outputName, ClipToolResult& result) {
+    Clock::time_point start = Clock::now();
+    Terrain terrain;
+    const bool parsed = terrain.readTerrainFile(fileName.data(), options.terrainScale);
+    result.parseTime = millisecondsSince(start);
+    if (!parsed) {
+        result.problem = "cannot be parsed";
+        return false;
+    }
+
+    start = Clock::now();
+    const bool valid = terrain.validate(result.problem);
+    result.validateTime = millisecondsSince(start);
+    if (!valid) {
+        return false;
+    }
+
+    start = Clock::now();
+    const bool written = terrain.writeBinaryFile(outputName.data());
+    result.writeTime = millisecondsSince(start);
+    if (!written) {
+        result.problem = "cannot write " + outputName;
+    }
+    return written;
+}
+
+std::size_t ClipTool::run(const std::string& inputDirectory, ThreadPool& pool, std::ostream& outStream) {
+    const std::vector<std::string> fileNames = findInputs(inputDirectory);
+
+    std::mutex outputMutex;
+    std::vector<ClipToolResult> results(fileNames.size());
+    const Clock::time_point start = Clock::now();
+    pool.parallelFor(fileNames.size(), [&](const std::size_t index) {
+        results[index] = process(fileNames[index], inputDirectory);
+
+        // as they finish, so a long run shows progress
+        std::lock_guard<std::mutex> lock(outputMutex);
+        printResult(results[index], outStream);
+    });
+    const double seconds = millisecondsSince(start) / 1000.0;
+
+    std::size_t failed = 0, frames = 0, inputBytes = 0, outputBytes = 0;
+    for (const auto& result : results) {
+        failed += result.succeeded ? 0 : 1;
+        frames += result.frames;
+        inputBytes += result.inputBytes;
+        outputBytes += result.succeeded ? result.outputBytes : 0;
+    }
+
+    const double megabytes = inputBytes / (1024.0 * 1024.0);
+    const double rate = seconds > 0.0 ? 1.0 / seconds : 0.0;
+    outStream << std::fixed << std::setprecision(2)
+              << fileNames.size() << " files, " << failed << " failed, " << frames << " frames in " << seconds
+              << " s on " << pool.size() << " threads" << std::endl
+              << fileNames.size() * rate << " files/s, " << frames * rate << " frames/s, " << megabytes * rate
+              << " MiB/s, " << megabytes << " MiB in, " << outputBytes / (1024.0 * 1024.0) << " MiB out"
+              << std::endl;
+    return failed;
+}
+
+void ClipTool::printResult(const ClipToolResult& result, std::ostream& outStream) {
+    outStream << std::fixed << std::setprecision(2) << result.fileName;
+    if (!result.succeeded) {
+        outStream << " failed: " << result.problem << std::endl;
+        return;
+    }
+
+    // terrains have no frames to bake
+    outStream << ": ";
+    if (result.frames > 0) {
+        outStream << result.frames << " frames, ";
+    }
+    outStream << "parse " << result.parseTime << " ms, validate " << result.validateTime << " ms, ";
+    if (result.frames > 0) {
+        outStream << "bake " << result.bakeTime << " ms, ";
+    }
+    outStream << "write " << result.writeTime << " ms, " << result.inputBytes / 1024.0 << " -> "
+              << result.outputBytes / 1024.0 << " KiB" << std::endl;
+}
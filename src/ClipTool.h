@@ -0,0 +1,71 @@
+#ifndef CLIP_TOOL_H
+#define CLIP_TOOL_H
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+#include "Retargeter.h"
+#include "Skeleton.h"
+#include "ThreadPool.h"
+
+struct ClipToolOptions {
+    std::string outputDirectory;
+    ClipEncoding encoding = ClipEncoding::Quantized;
+    // rewrite every clip's channels in X, Y, Z order, see BVH::bake
+    bool bake = true;
+    // x-y scale terrains are read with, the scene's
+    float terrainScale = 3.0f;
+    // skeleton every clip is retargeted onto before baking, nullptr to keep their own
+    std::shared_ptr<const Skeleton> retargetTarget;
+};
+
+// what happened to one input file, times in milliseconds
+struct ClipToolResult {
+    std::string fileName;
+    bool succeeded = false;
+    // the first problem found when not
+    std::string problem;
+    double parseTime = 0.0;
+    double validateTime = 0.0;
+    double bakeTime = 0.0;
+    double writeTime = 0.0;
+    std::size_t frames = 0;
+    std::size_t inputBytes = 0;
+    std::size_t outputBytes = 0;
+};
+
+// Offline preprocessing of .bvh clips and .dem terrains into the binary formats the app loads without parsing
+// Each file is parsed, validated, optionally retargeted, baked and written as <name>.clip or <name>.terrain under the
+// output directory, keeping its path relative to the input directory
+// Files are independent, so a run spreads them over a thread pool
+class ClipTool {
+public:
+    explicit ClipTool(ClipToolOptions options);
+
+    // every .bvh and .dem file under directory, in name order
+    static std::vector<std::string> findInputs(const std::string& directory);
+
+    // processes one file, inputDirectory is where its output path is taken relative to
+    // safe to call from any number of threads
+    ClipToolResult process(const std::string& fileName, const std::string& inputDirectory);
+
+    // processes every file of inputDirectory on pool, printing each result as it finishes and then the totals
+    // returns the number of files that failed
+    std::size_t run(const std::string& inputDirectory, ThreadPool& pool, std::ostream& outStream);
+
+private:
+    ClipToolOptions options;
+    std::unique_ptr<RetargeterCache> retargeters;
+
+    bool processClip(const std::string& fileName, const std::string& outputName, ClipToolResult& result);
+
+    bool processTerrain(const std::string& fileName, const std::string& outputName, ClipToolResult& result);
+
+    static void printResult(const ClipToolResult& result, std::ostream& outStream);
+};
+
+#endif
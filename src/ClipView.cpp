@@ -0,0 +1,41 @@
+#include "ClipView.h"
+
+#include <sstream>
+
+#include "ContentHash.h"
+
+bool ClipView::identity() const {
+    return firstFrame == 0 && frameCount == 0 && loop == LoopMode::Loop && rate == 1.0f && !mirrored;
+}
+
+std::string ClipView::describe() const {
+    std::ostringstream options;
+    if (firstFrame != 0) {
+        options << " from " << firstFrame;
+    }
+    if (frameCount != 0) {
+        options << " frames " << frameCount;
+    }
+    if (loop == LoopMode::PingPong) {
+        options << " pingpong";
+    }
+    if (rate != 1.0f) {
+        options << " rate " << rate;
+    }
+    if (mirrored) {
+        options << " mirror";
+    }
+
+    const std::string description = options.str();
+    return description.empty() ? description : description.substr(1);
+}
+
+std::uint64_t ClipView::hash(const std::uint64_t seed) const {
+    const int loopMode = static_cast<int>(loop);
+    const unsigned char mirror = mirrored;
+    std::uint64_t result = contentHash(&firstFrame, sizeof(firstFrame), seed);
+    result = contentHash(&frameCount, sizeof(frameCount), result);
+    result = contentHash(&loopMode, sizeof(loopMode), result);
+    result = contentHash(&rate, sizeof(rate), result);
+    return contentHash(&mirror, sizeof(mirror), result);
+}
@@ -0,0 +1,37 @@
+#ifndef CLIP_VIEW_H
+#define CLIP_VIEW_H
+
+#include <cstdint>
+#include <string>
+
+// how a view runs through its frame range
+enum class LoopMode {
+    // back to the first frame after the last
+    Loop,
+    // forwards to the last frame, then backwards to the first
+    PingPong
+};
+
+// Variant of a clip played from the clip's own storage, see BVH::makeView
+// The default view plays the whole clip unchanged
+struct ClipView {
+    // first source frame of the range
+    int firstFrame = 0;
+    // frames in the range, 0 runs to the end of the clip
+    int frameCount = 0;
+    LoopMode loop = LoopMode::Loop;
+    // source frames per frame of the view, 0.5 plays at half speed
+    float rate = 1.0f;
+    // swaps the left and right side of the skeleton, see Skeleton::mirrorJoints
+    bool mirrored = false;
+
+    // true when the view plays its clip unchanged
+    bool identity() const;
+
+    // fsm-style options, e.g. "from 10 frames 20 pingpong rate 0.5 mirror", empty for the identity
+    std::string describe() const;
+
+    std::uint64_t hash(std::uint64_t seed) const;
+};
+
+#endif
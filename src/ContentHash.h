@@ -0,0 +1,24 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64-bit FNV-1a, used to key cached assets by content
+constexpr std::uint64_t contentHashSeed = 14695981039346656037ull;
+
+inline std::uint64_t contentHash(const void* data, const std::size_t size, std::uint64_t hash = contentHashSeed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline std::uint64_t contentHash(const std::string& data, const std::uint64_t hash = contentHashSeed) {
+    return contentHash(data.data(), data.size(), hash);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "Crowd.h"
+
+#include <cmath>
+
+Crowd::Crowd(const int phaseQuantum): cache(phaseQuantum), atlas(nullptr), atlasPosed(0), clock(0) {
+}
+
+void Crowd::populate(const std::vector<const BVH*>& clips,
+                     const std::size_t count,
+                     const float spacing,
+                     const int phaseCount) {
+    members.clear();
+    if (clips.empty()) {
+        return;
+    }
+
+    // square grid with the centre left free for the player's character
+    const int side = static_cast<int>(std::ceil(std::sqrt(count + 1.0)));
+    for (int row = 0; row < side && members.size() < count; row++) {
+        for (int col = 0; col < side && members.size() < count; col++) {
+            const float x = (col - (side - 1) / 2.0f) * spacing;
+            const float y = (row - (side - 1) / 2.0f) * spacing;
+            if (std::fabs(x) < spacing / 2.0f && std::fabs(y) < spacing / 2.0f) {
+                continue;
+            }
+
+            const size_t index = members.size();
+            const BVH* clip = clips[index % clips.size()];
+            CrowdMember member{};
+            member.clip = clip;
+            member.clipIndex = index % clips.size();
+            member.phase = static_cast<int>((index / clips.size() % phaseCount) * clip->frameCount / phaseCount);
+            member.location = Cartesian3(x, y, 0.0f);
+            member.heading = static_cast<float>(37 * index % 360);
+            member.poseEntry = -1;
+            members.push_back(member);
+        }
+    }
+}
+
+void Crowd::setAtlas(const PoseAtlas* atlas) {
+    this->atlas = atlas;
+}
+
+bool Crowd::empty() const {
+    return members.empty();
+}
+
+std::size_t Crowd::size() const {
+    return members.size();
+}
+
+void Crowd::update(const Terrain* terrain, const Cartesian3& cameraPosition, const float scale) {
+    clock++;
+    cache.beginTick();
+    atlasPosed = 0;
+    const bool atlasUsable = atlas != nullptr && atlas->scale() == scale;
+
+    for (CrowdMember& member : members) {
+        if (terrain != nullptr) {
+            member.location.z = terrain->getHeight(member.location.x, member.location.y);
+        }
+
+        const int lod = lodPolicy.select((member.location - cameraPosition).length()).level;
+        const int frame = clock + member.phase;
+        if (atlasUsable && lod == LOD_LEVELS - 1) {
+            member.poseEntry = -1;
+            member.atlasPose = atlas->pose(member.clipIndex, frame * member.clip->frameDuration());
+            atlasPosed++;
+        } else {
+            member.poseEntry = cache.request(*member.clip, frame, scale, lod);
+            member.atlasPose = nullptr;
+        }
+        member.mask = member.clip->skeleton->lodMasks[lod].data();
+    }
+
+    // members sharing a skeleton are posed together
+    cache.evaluatePending();
+}
+
+void Crowd::snapshot(CrowdSnapshot& out) const {
+    out.poses.clear();
+    out.entryOffsets.clear();
+    for (std::size_t entry = 0; entry < cache.poseCount(); entry++) {
+        const std::vector<Affine3x4>& pose = cache.entryPose(entry);
+        out.entryOffsets.push_back(out.poses.size());
+        out.poses.insert(out.poses.end(), pose.begin(), pose.end());
+    }
+
+    out.instances.clear();
+    for (const CrowdMember& member : members) {
+        // members added since the last update have no pose yet
+        if (member.poseEntry < 0 && member.atlasPose == nullptr) {
+            continue;
+        }
+
+        // the shared pose only needs the member's own root transform
+        CrowdInstance instance{};
+        instance.skeleton = member.clip->skeleton.get();
+        instance.placement = Affine3x4::translation(member.location) * Affine3x4::rotationZ(member.heading);
+        instance.poseOffset = member.poseEntry < 0 ? 0 : out.entryOffsets[member.poseEntry];
+        instance.atlasPose = member.atlasPose;
+        instance.mask = member.mask;
+        out.instances.push_back(instance);
+    }
+}
+
+void CrowdSnapshot::render(const Matrix4& viewMatrix, const float scale) const {
+    for (const CrowdInstance& instance : instances) {
+        const Affine3x4* pose = instance.atlasPose != nullptr ? instance.atlasPose : poses.data() + instance.poseOffset;
+        BVH::renderPose(*instance.skeleton, viewMatrix * instance.placement, scale, pose, instance.mask);
+    }
+}
+
+PoseCache& Crowd::poseCache() {
+    return cache;
+}
+
+const PoseCache& Crowd::poseCache() const {
+    return cache;
+}
+
+std::size_t Crowd::atlasMembers() const {
+    return atlasPosed;
+}
@@ -0,0 +1,92 @@
+#ifndef CROWD_H
+#define CROWD_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "AnimationLod.h"
+#include "BVH.h"
+#include "Cartesian3.h"
+#include "Matrix4.h"
+#include "PoseAtlas.h"
+#include "PoseCache.h"
+#include "Terrain.h"
+
+// A background character looping a clip in place
+struct CrowdMember {
+    const BVH* clip;
+    // position of clip in the list given to populate
+    int clipIndex;
+    // frames ahead of the crowd's clock
+    int phase;
+    Cartesian3 location;
+    float heading;
+    // pose cache entry refreshed by update, -1 when posed from the atlas
+    int poseEntry;
+    // nullptr unless posed from the atlas
+    const Affine3x4* atlasPose;
+    const unsigned char* mask;
+};
+
+// A crowd member as drawn
+struct CrowdInstance {
+    const Skeleton* skeleton;
+    Affine3x4 placement;
+    // start of the member's pose in CrowdSnapshot::poses, unused when atlasPose is set
+    std::size_t poseOffset;
+    const Affine3x4* atlasPose;
+    const unsigned char* mask;
+};
+
+// What drawing a crowd needs from one update, copied out so the next update can run meanwhile
+struct CrowdSnapshot {
+    // every distinct pose of the tick once, shared by the instances using it
+    std::vector<Affine3x4> poses;
+    // pose cache entry -> start in poses
+    std::vector<std::size_t> entryOffsets;
+    std::vector<CrowdInstance> instances;
+
+    void render(const Matrix4& viewMatrix, float scale) const;
+};
+
+// Background characters whose poses come from a shared PoseCache
+class Crowd {
+public:
+    explicit Crowd(int phaseQuantum = 1);
+
+    // places count members on a grid around the origin, cycling through clips
+    // phases are drawn from phaseCount evenly spread values, so several members share each one
+    void populate(const std::vector<const BVH*>& clips, std::size_t count, float spacing, int phaseCount);
+
+    // members at the coarsest level of detail play from atlas instead of evaluating poses
+    // atlas must hold the clips given to populate, in the same order, nullptr disables it
+    void setAtlas(const PoseAtlas* atlas);
+
+    bool empty() const;
+
+    std::size_t size() const;
+
+    // advances the crowd's clock and fetches every member's pose
+    void update(const Terrain* terrain, const Cartesian3& cameraPosition, float scale);
+
+    // copies the poses and placements of the last update into out, reusing its storage
+    void snapshot(CrowdSnapshot& out) const;
+
+    PoseCache& poseCache();
+
+    const PoseCache& poseCache() const;
+
+    // members posed from the atlas by the last update
+    std::size_t atlasMembers() const;
+
+private:
+    std::vector<CrowdMember> members;
+    PoseCache cache;
+    LodPolicy lodPolicy;
+    const PoseAtlas* atlas;
+    std::size_t atlasPosed;
+    int clock;
+};
+
+#endif
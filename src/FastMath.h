@@ -0,0 +1,136 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+// Which trigonometry a rotation builder uses
+// Exact goes through std::sin, std::cos and std::acos, Fast through the approximations below
+enum class Precision {
+    Exact, Fast
+};
+
+constexpr float FAST_PI = 3.14159265358979f;
+
+constexpr float DEGREES_TO_RADIANS = FAST_PI / 180.0f;
+
+// largest absolute error of fastSinCos against std::sin and std::cos over |radians| <= FAST_SINCOS_RANGE
+constexpr float FAST_SINCOS_MAX_ERROR = 2.5e-7f;
+constexpr float FAST_SINCOS_RANGE = 8192.0f;
+
+// largest absolute error of fastAcos against std::acos over [-1, 1], in radians
+constexpr float FAST_ACOS_MAX_ERROR = 5e-7f;
+
+// sine and cosine at once, without branches so that loops over arrays of angles vectorise
+// The angle is reduced to [-pi / 4, pi / 4] around the nearest multiple of pi / 2, where minimax polynomials
+// (Cephes sinf and cosf) are evaluated, and the quadrant then picks and signs the results
+inline void fastSinCos(const float radians, float& sine, float& cosine) {
+    // pi / 2 split in two so that subtracting multiples of it stays exact for moderate angles
+    constexpr float HALF_PI_HIGH = 1.5703125f;
+    constexpr float HALF_PI_LOW = 4.83826794896619e-4f;
+    constexpr float TWO_OVER_PI = 0.636619772367581f;
+
+    const float quadrants = radians * TWO_OVER_PI;
+    const int quadrant = static_cast<int>(quadrants + (quadrants < 0.0f ? -0.5f : 0.5f));
+    const float reduced = (radians - quadrant * HALF_PI_HIGH) - quadrant * HALF_PI_LOW;
+    const float square = reduced * reduced;
+
+    const float s = reduced + reduced * square *
+                    (-1.6666654611e-1f + square * (8.3321608736e-3f + square * -1.9515295891e-4f));
+    const float c = 1.0f - 0.5f * square + square * square *
+                    (4.166664568298827e-2f + square * (-1.388731625493765e-3f + square * 2.443315711809948e-5f));
+
+    // odd quadrants swap sine and cosine, the sign follows the quadrant
+    const bool swap = (quadrant & 1) != 0;
+    const float sineMagnitude = swap ? c : s;
+    const float cosineMagnitude = swap ? s : c;
+    sine = (quadrant & 2) != 0 ? -sineMagnitude : sineMagnitude;
+    cosine = ((quadrant + 1) & 2) != 0 ? -cosineMagnitude : cosineMagnitude;
+}
+
+// count angles at once
+// the arrays must not overlap, and count should be a compile-time multiple of 4 for the loop to vectorise at -O2
+inline void fastSinCos(const float* __restrict radians,
+                       float* __restrict sines,
+                       float* __restrict cosines,
+                       const std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        fastSinCos(radians[i], sines[i], cosines[i]);
+    }
+}
+
+// arc cosine of x in [-1, 1], Abramowitz and Stegun 4.4.46 on |x| and reflected for negative x
+inline float fastAcos(const float x) {
+    const float magnitude = std::fabs(x);
+    const float polynomial = 1.5707963050f + magnitude * (-0.2145988016f + magnitude * (0.0889789874f + magnitude *
+                             (-0.0501743046f + magnitude * (0.0308918810f + magnitude * (-0.0170881256f + magnitude *
+                             (0.0066700901f + magnitude * -0.0012624911f))))));
+    const float result = std::sqrt(1.0f - magnitude) * polynomial;
+    return x < 0.0f ? FAST_PI - result : result;
+}
+
+// sine and cosine through std:: or fastSinCos
+inline void sinCos(const float radians, const Precision precision, float& sine, float& cosine) {
+    if (precision == Precision::Fast) {
+        fastSinCos(radians, sine, cosine);
+        return;
+    }
+
+    sine = std::sin(radians);
+    cosine = std::cos(radians);
+}
+
+// as sinCos, the exact path converts to radians in double precision like DEG2RAD
+inline void sinCosDegrees(const float degrees, const Precision precision, float& sine, float& cosine) {
+    const float radians =
+            precision == Precision::Fast ? degrees * DEGREES_TO_RADIANS : static_cast<float>(M_PI * degrees / 180.0);
+    sinCos(radians, precision, sine, cosine);
+}
+
+inline float acosOf(const float x, const Precision precision) {
+    return precision == Precision::Fast ? fastAcos(x) : std::acos(x);
+}
+
+// compile-time sine and cosine for tables, Taylor series around 0 after reducing to [-pi, pi]
+constexpr double constexprSin(double radians) {
+    constexpr double pi = 3.14159265358979323846;
+    while (radians > pi) {
+        radians -= 2.0 * pi;
+    }
+    while (radians < -pi) {
+        radians += 2.0 * pi;
+    }
+
+    double term = radians;
+    double sum = radians;
+    for (int n = 1; n < 20; n++) {
+        term *= -radians * radians / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprCos(const double radians) {
+    return constexprSin(radians + 3.14159265358979323846 / 2.0);
+}
+
+// Points around a unit circle, Steps evenly spaced angles starting at 0, built at compile time
+template <int Steps>
+struct RingTable {
+    std::array<float, Steps> cosines;
+    std::array<float, Steps> sines;
+};
+
+template <int Steps>
+constexpr RingTable<Steps> makeRingTable() {
+    RingTable<Steps> table{};
+    for (int step = 0; step < Steps; step++) {
+        const double angle = 2.0 * 3.14159265358979323846 * step / Steps;
+        table.cosines[step] = static_cast<float>(constexprCos(angle));
+        table.sines[step] = static_cast<float>(constexprSin(angle));
+    }
+    return table;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "FootIk.h"
+
+#include <algorithm>
+#include <cmath>
+
+// keeps a fully stretched leg from snapping straight, as a fraction of its length
+constexpr float MAX_EXTENSION = 0.999f;
+constexpr float EPSILON = 1e-6f;
+
+void LegPoints::resize(const std::size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+}
+
+Cartesian3 LegPoints::operator [](const std::size_t leg) const {
+    return Cartesian3(x[leg], y[leg], z[leg]);
+}
+
+void LegPoints::set(const std::size_t leg, const Cartesian3& point) {
+    x[leg] = point.x;
+    y[leg] = point.y;
+    z[leg] = point.z;
+}
+
+void TwoBoneBatch::resize(const std::size_t count) {
+    hips.resize(count);
+    knees.resize(count);
+    ankles.resize(count);
+    targets.resize(count);
+    solvedKnees.resize(count);
+    solvedAnkles.resize(count);
+}
+
+std::size_t TwoBoneBatch::size() const {
+    return hips.x.size();
+}
+
+void solveTwoBone(TwoBoneBatch& batch) {
+    const std::size_t count = batch.size();
+    const float* hx = batch.hips.x.data();
+    const float* hy = batch.hips.y.data();
+    const float* hz = batch.hips.z.data();
+    const float* kx = batch.knees.x.data();
+    const float* ky = batch.knees.y.data();
+    const float* kz = batch.knees.z.data();
+    const float* ax = batch.ankles.x.data();
+    const float* ay = batch.ankles.y.data();
+    const float* az = batch.ankles.z.data();
+    const float* tx = batch.targets.x.data();
+    const float* ty = batch.targets.y.data();
+    const float* tz = batch.targets.z.data();
+    float* skx = batch.solvedKnees.x.data();
+    float* sky = batch.solvedKnees.y.data();
+    float* skz = batch.solvedKnees.z.data();
+    float* sax = batch.solvedAnkles.x.data();
+    float* say = batch.solvedAnkles.y.data();
+    float* saz = batch.solvedAnkles.z.data();
+
+    // law of cosines, no branches or trigonometry so the loop vectorises
+    for (std::size_t leg = 0; leg < count; leg++) {
+        const float thighX = kx[leg] - hx[leg], thighY = ky[leg] - hy[leg], thighZ = kz[leg] - hz[leg];
+        const float shinX = ax[leg] - kx[leg], shinY = ay[leg] - ky[leg], shinZ = az[leg] - kz[leg];
+        const float upper = std::sqrt(thighX * thighX + thighY * thighY + thighZ * thighZ);
+        const float lower = std::sqrt(shinX * shinX + shinY * shinY + shinZ * shinZ);
+
+        // direction and reachable distance from hip to target
+        const float reachX = tx[leg] - hx[leg], reachY = ty[leg] - hy[leg], reachZ = tz[leg] - hz[leg];
+        const float reach = std::sqrt(reachX * reachX + reachY * reachY + reachZ * reachZ);
+        const float inverseReach = 1.0f / std::max(reach, EPSILON);
+        const float ux = reachX * inverseReach, uy = reachY * inverseReach, uz = reachZ * inverseReach;
+        const float distance = std::clamp(reach, std::fabs(upper - lower) + EPSILON,
+                                          std::max(MAX_EXTENSION * (upper + lower), EPSILON));
+
+        // knee projected on the hip-target line, and its distance from that line
+        const float along = (upper * upper - lower * lower + distance * distance) / (2.0f * distance);
+        const float across = std::sqrt(std::max(upper * upper - along * along, 0.0f));
+
+        // the current knee direction off the line gives the bending plane,
+        // a small forward bias covers legs animated perfectly straight
+        const float projection = thighX * ux + thighY * uy + thighZ * uz;
+        const float bendX = thighX - projection * ux;
+        const float bendY = thighY - projection * uy + EPSILON * upper;
+        const float bendZ = thighZ - projection * uz;
+        const float inverseBend = 1.0f / std::max(std::sqrt(bendX * bendX + bendY * bendY + bendZ * bendZ), EPSILON);
+
+        skx[leg] = hx[leg] + along * ux + across * bendX * inverseBend;
+        sky[leg] = hy[leg] + along * uy + across * bendY * inverseBend;
+        skz[leg] = hz[leg] + along * uz + across * bendZ * inverseBend;
+        sax[leg] = hx[leg] + distance * ux;
+        say[leg] = hy[leg] + distance * uy;
+        saz[leg] = hz[leg] + distance * uz;
+    }
+}
+
+// rotation about pivot taking direction from onto direction to
+static Affine3x4 rotationAbout(const Cartesian3& pivot, const Cartesian3& from, const Cartesian3& to) {
+    // rotateBetween has no axis for (anti)parallel vectors, those are left alone
+    if (from.cross(to).length() <= EPSILON * from.length() * to.length()) {
+        return Affine3x4::identity();
+    }
+    return Affine3x4::translation(pivot) * Affine3x4(Matrix4::rotateBetween(from, to)) * Affine3x4::translation(-pivot);
+}
+
+static Cartesian3 jointPosition(const Affine3x4& jointMatrix) {
+    return jointMatrix.origin();
+}
+
+FootIk::FootIk(): footAlignment(1.0f) {
+}
+
+void FootIk::apply(const Terrain& terrain, const std::size_t count, GroundedCharacter* characters) {
+    // legs the level of detail dropped are not drawn, so they are not solved either
+    std::size_t legCount = 0;
+    for (std::size_t character = 0; character < count; character++) {
+        const GroundedCharacter& grounded = characters[character];
+        for (const LegChain& chain : grounded.skeleton->legs) {
+            const unsigned char* mask = grounded.mask;
+            legCount += mask == nullptr || (mask[chain.hip] && mask[chain.knee] && mask[chain.ankle]);
+        }
+    }
+
+    batch.resize(legCount);
+    legCharacters.resize(legCount);
+    legChains.resize(legCount);
+    groundNormals.resize(legCount);
+    pelvisOffsets.assign(count, 0.0f);
+
+    // gather: sample the terrain under every ankle, in model space
+    std::size_t leg = 0;
+    for (std::size_t character = 0; character < count; character++) {
+        const GroundedCharacter& grounded = characters[character];
+        const float c = grounded.headingCos;
+        const float s = grounded.headingSin;
+        const std::size_t firstLeg = leg;
+
+        for (const LegChain& chain : grounded.skeleton->legs) {
+            const unsigned char* mask = grounded.mask;
+            if (mask != nullptr && !(mask[chain.hip] && mask[chain.knee] && mask[chain.ankle])) {
+                continue;
+            }
+
+            const Cartesian3 ankle = jointPosition(grounded.jointMatrices[chain.ankle]);
+            const float worldX = grounded.location.x + c * ankle.x - s * ankle.y;
+            const float worldY = grounded.location.y + s * ankle.x + c * ankle.y;
+            const float ground = terrain.getHeight(worldX, worldY) - grounded.location.z;
+            const Cartesian3 normal = terrain.getNormal(worldX, worldY);
+
+            legCharacters[leg] = character;
+            legChains[leg] = &chain;
+            groundNormals[leg] = Cartesian3(c * normal.x + s * normal.y, c * normal.y - s * normal.x, normal.z);
+            batch.targets.set(leg, ankle + Cartesian3(0.0f, 0.0f, ground));
+            // the lowest ground under a foot sets how far the pelvis has to drop
+            pelvisOffsets[character] = std::min(pelvisOffsets[character], ground);
+            leg++;
+        }
+
+        const Cartesian3 pelvisOffset(0.0f, 0.0f, pelvisOffsets[character]);
+        for (std::size_t solved = firstLeg; solved < leg; solved++) {
+            const LegChain& chain = *legChains[solved];
+            batch.hips.set(solved, jointPosition(grounded.jointMatrices[chain.hip]) + pelvisOffset);
+            batch.knees.set(solved, jointPosition(grounded.jointMatrices[chain.knee]) + pelvisOffset);
+            batch.ankles.set(solved, jointPosition(grounded.jointMatrices[chain.ankle]) + pelvisOffset);
+        }
+    }
+
+    solveTwoBone(batch);
+
+    // scatter: drop each pelvis, then rotate thigh, shin and foot onto the solution
+    for (std::size_t character = 0; character < count; character++) {
+        const GroundedCharacter& grounded = characters[character];
+        const std::size_t jointCount = grounded.skeleton->jointCount();
+        for (std::size_t joint = 0; joint < jointCount; joint++) {
+            grounded.jointMatrices[joint][2][3] += pelvisOffsets[character];
+        }
+    }
+
+    const Cartesian3 up(0.0f, 0.0f, 1.0f);
+    for (leg = 0; leg < legCount; leg++) {
+        const GroundedCharacter& grounded = characters[legCharacters[leg]];
+        const Skeleton& skeleton = *grounded.skeleton;
+        const LegChain& chain = *legChains[leg];
+        const Cartesian3 hip = batch.hips[leg];
+        const Cartesian3 knee = batch.solvedKnees[leg];
+        const Cartesian3 ankle = batch.solvedAnkles[leg];
+
+        transformSubtree(skeleton, grounded.jointMatrices, chain.hip,
+                         rotationAbout(hip, batch.knees[leg] - hip, knee - hip));
+
+        const Cartesian3 swungAnkle = jointPosition(grounded.jointMatrices[chain.ankle]);
+        transformSubtree(skeleton, grounded.jointMatrices, chain.knee,
+                         rotationAbout(knee, swungAnkle - knee, ankle - knee));
+
+        const Cartesian3 footUp = up + footAlignment * (groundNormals[leg] - up);
+        transformSubtree(skeleton, grounded.jointMatrices, chain.ankle, rotationAbout(ankle, up, footUp));
+    }
+}
+
+void FootIk::transformSubtree(const Skeleton& skeleton,
+                              Affine3x4* jointMatrices,
+                              const int joint,
+                              const Affine3x4& transform) {
+    for (int descendant = joint; descendant < skeleton.subtreeEnds[joint]; descendant++) {
+        jointMatrices[descendant] = transform * jointMatrices[descendant];
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef FOOT_IK_H
+#define FOOT_IK_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "Cartesian3.h"
+#include "Skeleton.h"
+#include "Terrain.h"
+
+// Points of many legs as structure of arrays, so the solver runs as straight loops over floats
+struct LegPoints {
+    std::vector<float> x, y, z;
+
+    void resize(std::size_t count);
+
+    Cartesian3 operator [](std::size_t leg) const;
+
+    void set(std::size_t leg, const Cartesian3& point);
+};
+
+// Two-bone problems, one per leg
+struct TwoBoneBatch {
+    LegPoints hips;
+    LegPoints knees;
+    LegPoints ankles;
+    LegPoints targets;
+
+    // written by solveTwoBone
+    LegPoints solvedKnees;
+    LegPoints solvedAnkles;
+
+    void resize(std::size_t count);
+
+    std::size_t size() const;
+};
+
+// Analytic two-bone IK over a whole batch
+// Ankles are placed as close to their targets as the leg reaches, bone lengths are kept
+// and knees stay in the plane they bent in
+void solveTwoBone(TwoBoneBatch& batch);
+
+// A posed character to fit to the ground
+struct GroundedCharacter {
+    const Skeleton* skeleton;
+    // model-space joint transforms, adjusted in place
+    Affine3x4* jointMatrices;
+    // joints left out by the level of detail, nullptr for all joints
+    const unsigned char* mask;
+    // world position of the model origin
+    Cartesian3 location;
+    // rotation about Z from model to world
+    float headingCos;
+    float headingSin;
+};
+
+// Post-FK pass bending the legs of posed characters onto the terrain under their feet
+// Clips are assumed to be recorded on flat ground at the height of the model origin
+class FootIk {
+public:
+    FootIk();
+
+    // gathers the legs of every character, solves them in one batch and writes the poses back
+    void apply(const Terrain& terrain, std::size_t count, GroundedCharacter* characters);
+
+    // 0 keeps the animated foot orientation, 1 lays the foot flat on the terrain slope
+    float footAlignment;
+
+private:
+    // rigidly moves joint and its descendants
+    static void transformSubtree(const Skeleton& skeleton, Affine3x4* jointMatrices, int joint,
+                                 const Affine3x4& transform);
+
+    TwoBoneBatch batch;
+    // per solved leg
+    std::vector<std::size_t> legCharacters;
+    std::vector<const LegChain*> legChains;
+    std::vector<Cartesian3> groundNormals;
+    // per character, how far the pelvis drops for the lower foot to reach the ground
+    std::vector<float> pelvisOffsets;
+};
+
+#endif
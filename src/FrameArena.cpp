@@ -0,0 +1,75 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// Per-thread arena size, comfortably above what a tick needs for a single character
+constexpr std::size_t defaultArenaCapacity = 256 * 1024;
+
+FrameArena::FrameArena(const std::size_t capacity)
+    : buffer(new char[capacity]),
+      bufferCapacity(capacity),
+      offset(0),
+      spilled(0),
+      peak(0) {
+}
+
+FrameArena::~FrameArena() {
+    reset();
+    delete[] buffer;
+}
+
+void* FrameArena::allocate(const std::size_t bytes, const std::size_t alignment) {
+    const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(buffer);
+    const std::uintptr_t aligned = (base + offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+    const std::size_t end = aligned - base + bytes;
+
+    if (end <= bufferCapacity) {
+        offset = end;
+        peak = std::max(peak, offset + spilled);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // out of space, fall back to the heap until the next reset
+    char* block = new char[bytes + alignment];
+    overflow.push_back(block);
+    spilled += bytes + alignment;
+    peak = std::max(peak, offset + spilled);
+
+    const std::uintptr_t blockBase = reinterpret_cast<std::uintptr_t>(block);
+    return reinterpret_cast<void*>((blockBase + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1));
+}
+
+void FrameArena::reset() {
+    for (char* block : overflow) {
+        delete[] block;
+    }
+    overflow.clear();
+
+    // grow once so that the spilled workload fits next time
+    if (spilled > 0) {
+        delete[] buffer;
+        bufferCapacity = 2 * (offset + spilled);
+        buffer = new char[bufferCapacity];
+    }
+
+    offset = 0;
+    spilled = 0;
+}
+
+std::size_t FrameArena::used() const {
+    return offset + spilled;
+}
+
+std::size_t FrameArena::capacity() const {
+    return bufferCapacity;
+}
+
+std::size_t FrameArena::highWater() const {
+    return peak;
+}
+
+FrameArena& FrameArena::local() {
+    thread_local FrameArena arena(defaultArenaCapacity);
+    return arena;
+}
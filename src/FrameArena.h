@@ -0,0 +1,58 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Linear allocator for transient data that lives at most until the end of a tick
+// Allocation is a pointer bump, reset() releases everything at once
+class FrameArena {
+public:
+    explicit FrameArena(std::size_t capacity);
+
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // never fails: requests beyond capacity spill into heap blocks until the next reset,
+    // which then grows the arena so that later ticks stay within a single block
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+    // default-constructed array, destructors are never run
+    template<typename T>
+    T* allocateArray(std::size_t count);
+
+    void reset();
+
+    std::size_t used() const;
+
+    std::size_t capacity() const;
+
+    // largest number of bytes requested between two resets
+    std::size_t highWater() const;
+
+    // arena owned by the calling thread
+    static FrameArena& local();
+
+private:
+    char* buffer;
+    std::size_t bufferCapacity;
+    std::size_t offset;
+    std::size_t spilled;
+    std::size_t peak;
+    std::vector<char*> overflow;
+};
+
+template<typename T>
+T* FrameArena::allocateArray(const std::size_t count) {
+    T* result = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    for (std::size_t i = 0; i < count; i++) {
+        new(result + i) T();
+    }
+    return result;
+}
+
+#endif
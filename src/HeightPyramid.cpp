@@ -0,0 +1,264 @@
+#include "HeightPyramid.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+void HeightPyramid::build(const std::vector<std::vector<float>>& heights) {
+    levels.clear();
+
+    Level base;
+    base.rows = static_cast<long>(heights.size()) - 1;
+    base.columns = static_cast<long>(heights[0].size()) - 1;
+    levels.push_back(std::move(base));
+    while (levels.back().rows > 1 || levels.back().columns > 1) {
+        Level above;
+        above.rows = (levels.back().rows + 1) / 2;
+        above.columns = (levels.back().columns + 1) / 2;
+        levels.push_back(std::move(above));
+    }
+
+    for (size_t level = 0; level < levels.size(); level++) {
+        levels[level].nodes.resize(levels[level].rows * levels[level].columns);
+        for (long row = 0; row < levels[level].rows; row++) {
+            for (long column = 0; column < levels[level].columns; column++) {
+                computeNode(heights, level, row, column);
+            }
+        }
+    }
+}
+
+void HeightPyramid::update(const std::vector<std::vector<float>>& heights,
+                           const long firstRow,
+                           const long lastRow,
+                           const long firstColumn,
+                           const long lastColumn) {
+    // a grid point is a corner of the squares above and to the left of it as well
+    long rowBegin = std::max(firstRow - 1, 0L);
+    long rowEnd = std::min(lastRow, levels[0].rows - 1);
+    long columnBegin = std::max(firstColumn - 1, 0L);
+    long columnEnd = std::min(lastColumn, levels[0].columns - 1);
+
+    for (size_t level = 0; level < levels.size(); level++) {
+        for (long row = rowBegin; row <= rowEnd; row++) {
+            for (long column = columnBegin; column <= columnEnd; column++) {
+                computeNode(heights, level, row, column);
+            }
+        }
+        rowBegin /= 2;
+        rowEnd /= 2;
+        columnBegin /= 2;
+        columnEnd /= 2;
+    }
+}
+
+int HeightPyramid::levelCount() const {
+    return levels.size();
+}
+
+void HeightPyramid::computeNode(const std::vector<std::vector<float>>& heights,
+                                const int level,
+                                const long row,
+                                const long column) {
+    Bounds& node = levels[level].nodes[row * levels[level].columns + column];
+    if (level == 0) {
+        const float corners[4] = {heights[row][column], heights[row][column + 1],
+                                  heights[row + 1][column], heights[row + 1][column + 1]};
+        node.minimum = *std::min_element(corners, corners + 4);
+        node.maximum = *std::max_element(corners, corners + 4);
+        return;
+    }
+
+    const Level& below = levels[level - 1];
+    node.minimum = std::numeric_limits<float>::max();
+    node.maximum = std::numeric_limits<float>::lowest();
+    for (long childRow = 2 * row; childRow < std::min(2 * row + 2, below.rows); childRow++) {
+        for (long childColumn = 2 * column; childColumn < std::min(2 * column + 2, below.columns); childColumn++) {
+            const Bounds& child = below.nodes[childRow * below.columns + childColumn];
+            node.minimum = std::min(node.minimum, child.minimum);
+            node.maximum = std::max(node.maximum, child.maximum);
+        }
+    }
+}
+
+bool HeightPyramid::intersect(const std::vector<std::vector<float>>& heights,
+                              const Cartesian3& origin,
+                              const Cartesian3& direction,
+                              const float maxT,
+                              float& t) const {
+    if (levels.empty()) {
+        return false;
+    }
+
+    // the top level is a single node over the whole grid
+    const Ray ray{origin, direction};
+    float t0 = 0.0f, t1 = maxT;
+    return clipToBox(ray, 0.0f, static_cast<float>(levels[0].rows), 0.0f, static_cast<float>(levels[0].columns),
+                     t0, t1) &&
+           intersectNode(heights, ray, levels.size() - 1, 0, 0, t0, t1, t);
+}
+
+bool HeightPyramid::intersectNode(const std::vector<std::vector<float>>& heights,
+                                  const Ray& ray,
+                                  const int level,
+                                  const long row,
+                                  const long column,
+                                  const float t0,
+                                  const float t1,
+                                  float& t) const {
+    // the surface inside the node lies between its bounds, so a ray staying above them misses it
+    const Bounds& node = levels[level].nodes[row * levels[level].columns + column];
+    const float z0 = ray.origin.z + t0 * ray.direction.z;
+    const float z1 = ray.origin.z + t1 * ray.direction.z;
+    if (std::min(z0, z1) > node.maximum) {
+        return false;
+    }
+
+    if (level == 0) {
+        return intersectSquare(heights, ray, row, column, t0, t1, t);
+    }
+
+    // squares of a child, the last row and column of nodes may cover fewer
+    const long childSize = 1L << (level - 1);
+    const Level& below = levels[level - 1];
+
+    // children along the ray do not overlap, so visiting them by entry leaves the nearest hit first
+    struct Child {
+        float t0, t1;
+        long row, column;
+    };
+    Child children[4];
+    int childCount = 0;
+    for (long childRow = 2 * row; childRow < std::min(2 * row + 2, below.rows); childRow++) {
+        for (long childColumn = 2 * column; childColumn < std::min(2 * column + 2, below.columns); childColumn++) {
+            Child& child = children[childCount];
+            child = Child{t0, t1, childRow, childColumn};
+            if (clipToBox(ray, static_cast<float>(childRow * childSize),
+                          static_cast<float>(std::min((childRow + 1) * childSize, levels[0].rows)),
+                          static_cast<float>(childColumn * childSize),
+                          static_cast<float>(std::min((childColumn + 1) * childSize, levels[0].columns)),
+                          child.t0, child.t1)) {
+                childCount++;
+            }
+        }
+    }
+    for (int child = 1; child < childCount; child++) {
+        for (int at = child; at > 0 && children[at].t0 < children[at - 1].t0; at--) {
+            std::swap(children[at], children[at - 1]);
+        }
+    }
+
+    for (int child = 0; child < childCount; child++) {
+        if (intersectNode(heights, ray, level - 1, children[child].row, children[child].column,
+                          children[child].t0, children[child].t1, t)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeightPyramid::clipToBox(const Ray& ray,
+                              const float firstRow,
+                              const float lastRow,
+                              const float firstColumn,
+                              const float lastColumn,
+                              float& t0,
+                              float& t1) {
+    // u runs along x and v along y
+    const float low[2] = {firstColumn, firstRow};
+    const float high[2] = {lastColumn, lastRow};
+    for (int axis = 0; axis < 2; axis++) {
+        const float origin = ray.origin[axis];
+        const float direction = ray.direction[axis];
+        if (direction == 0.0f) {
+            if (origin < low[axis] || origin > high[axis]) {
+                return false;
+            }
+            continue;
+        }
+
+        float enter = (low[axis] - origin) / direction;
+        float exit = (high[axis] - origin) / direction;
+        if (enter > exit) {
+            std::swap(enter, exit);
+        }
+        t0 = std::max(t0, enter);
+        t1 = std::min(t1, exit);
+    }
+    return t0 <= t1;
+}
+
+bool HeightPyramid::intersectSquare(const std::vector<std::vector<float>>& heights,
+                                    const Ray& ray,
+                                    const long row,
+                                    const long column,
+                                    const float t0,
+                                    const float t1,
+                                    float& t) {
+    const float h00 = heights[row][column];
+    const float h01 = heights[row][column + 1];
+    const float h10 = heights[row + 1][column];
+    const float h11 = heights[row + 1][column + 1];
+
+    // ray height above the surface at t, on the triangle the point at t lies in
+    const auto above = [&](const float at) {
+        const float fx = ray.origin.x + at * ray.direction.x - column;
+        const float fy = ray.origin.y + at * ray.direction.y - row;
+        const float surface = fx >= fy ? h00 + fx * (h01 - h00) + fy * (h11 - h01)
+                                       : h00 + fy * (h10 - h00) + fx * (h11 - h10);
+        return ray.origin.z + at * ray.direction.z - surface;
+    };
+
+    // the height difference is continuous and linear on each triangle, the ray may cross the diagonal once
+    float pieces[3] = {t0, t1, t1};
+    int pieceCount = 1;
+    const float diagonal = ray.direction.x - ray.direction.y;
+    if (diagonal != 0.0f) {
+        const float crossing = -(ray.origin.x - column - (ray.origin.y - row)) / diagonal;
+        if (crossing > t0 && crossing < t1) {
+            pieces[1] = crossing;
+            pieceCount = 2;
+        }
+    }
+
+    for (int piece = 0; piece < pieceCount; piece++) {
+        const float start = pieces[piece];
+        const float end = pieces[piece + 1];
+        const float startAbove = above(start);
+        if (startAbove <= 0.0f) {
+            t = start;
+            return true;
+        }
+        const float endAbove = above(end);
+        if (endAbove <= 0.0f) {
+            t = start + (end - start) * startAbove / (startAbove - endAbove);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeightPyramid::intersectEverySquare(const std::vector<std::vector<float>>& heights,
+                                         const Cartesian3& origin,
+                                         const Cartesian3& direction,
+                                         const float maxT,
+                                         float& t) {
+    const Ray ray{origin, direction};
+    const long rows = static_cast<long>(heights.size()) - 1;
+    const long columns = static_cast<long>(heights[0].size()) - 1;
+
+    bool hit = false;
+    t = maxT;
+    for (long row = 0; row < rows; row++) {
+        for (long column = 0; column < columns; column++) {
+            float t0 = 0.0f, t1 = t;
+            float squareT;
+            if (clipToBox(ray, row, row + 1, column, column + 1, t0, t1) &&
+                intersectSquare(heights, ray, row, column, t0, t1, squareT) && squareT <= t) {
+                t = squareT;
+                hit = true;
+            }
+        }
+    }
+    return hit;
+}
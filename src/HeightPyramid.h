@@ -0,0 +1,70 @@
+#ifndef HEIGHT_PYRAMID_H
+#define HEIGHT_PYRAMID_H
+
+#include <vector>
+
+#include "Cartesian3.h"
+
+// Lowest and highest height of each square of a height grid, and of each 2x2 block of the level below, up to a
+// single node covering the whole grid
+// Rays descend only into nodes whose height range they pass through, so flat stretches far above or below the ray
+// are skipped whole and only the squares next to the ray's path are tested exactly
+// Works in grid space: u along columns and v along rows, both in squares, and z as the heights themselves
+class HeightPyramid {
+public:
+    // heights is indexed [row][column] and at least 2x2
+    void build(const std::vector<std::vector<float>>& heights);
+
+    // recomputes the nodes over squares with a corner in rows [firstRow, lastRow] and columns [firstColumn, lastColumn]
+    void update(const std::vector<std::vector<float>>& heights, long firstRow, long lastRow,
+                long firstColumn, long lastColumn);
+
+    // first t in [0, maxT] at which origin + t * direction is on or below the surface, heights must be those built from
+    // split along the diagonal from each square's top left corner, the triangles Terrain draws
+    // a ray starting below the surface hits at t = 0
+    bool intersect(const std::vector<std::vector<float>>& heights, const Cartesian3& origin,
+                   const Cartesian3& direction, float maxT, float& t) const;
+
+    // the same answer by testing every square, for measuring intersect against
+    static bool intersectEverySquare(const std::vector<std::vector<float>>& heights, const Cartesian3& origin,
+                                     const Cartesian3& direction, float maxT, float& t);
+
+    int levelCount() const;
+
+private:
+    struct Bounds {
+        float minimum;
+        float maximum;
+    };
+
+    // level 0 has a node per square, each level above halves both sides, rounding up
+    struct Level {
+        long rows;
+        long columns;
+        std::vector<Bounds> nodes;
+    };
+
+    struct Ray {
+        Cartesian3 origin;
+        Cartesian3 direction;
+    };
+
+    std::vector<Level> levels;
+
+    // bounds of node (row, column) of level from its children, or from the heights for level 0
+    void computeNode(const std::vector<std::vector<float>>& heights, int level, long row, long column);
+
+    // the ray within [t0, t1], its span inside node (row, column) of level, children nearest first
+    bool intersectNode(const std::vector<std::vector<float>>& heights, const Ray& ray, int level, long row,
+                       long column, float t0, float t1, float& t) const;
+
+    // clips [t0, t1] to the ray's span over the squares [firstRow, lastRow) x [firstColumn, lastColumn)
+    static bool clipToBox(const Ray& ray, float firstRow, float lastRow, float firstColumn, float lastColumn,
+                          float& t0, float& t1);
+
+    // the ray within [t0, t1] against the two triangles of square (row, column)
+    static bool intersectSquare(const std::vector<std::vector<float>>& heights, const Ray& ray, long row,
+                                long column, float t0, float t1, float& t);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "Inertialization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MemoryTracker.h"
+
+// polynomial terms stored per channel
+constexpr int TERMS = 6;
+
+// smallest difference between two angles in degrees
+static float angleDifference(const float a, const float b) {
+    const float difference = a - b;
+    return difference - 360.0f * std::round(difference / 360.0f);
+}
+
+Inertialization::Inertialization(): elapsed(0), length(0) {
+}
+
+void Inertialization::start(const BVH& from, const int fromFrame, const BVH& to, const int toFrame, const int frames) {
+    MemoryScope memoryScope(MemorySubsystem::Blending);
+
+    if (from.skeleton != to.skeleton && !from.skeleton->sameAs(*to.skeleton)) {
+        cancel();
+        return;
+    }
+
+    const size_t joints = to.skeleton->jointCount();
+    scratch.resize(4 * joints);
+    const Cartesian3* outgoing = from.rotations(fromFrame, &scratch[0]);
+    const Cartesian3* outgoingPrevious = from.rotations(fromFrame + from.frameCount - 1, &scratch[joints]);
+    const Cartesian3* incoming = to.rotations(toFrame, &scratch[2 * joints]);
+    const Cartesian3* incomingNext = to.rotations(toFrame + 1, &scratch[3 * joints]);
+
+    const bool carryOver = active() && current.size() == joints;
+    const size_t channels = 3 * joints;
+    coefficients.resize(TERMS * channels);
+    durations.resize(channels);
+
+    for (size_t channel = 0; channel < channels; channel++) {
+        const size_t joint = channel / 3;
+        const int axis = channel % 3;
+
+        // what was on screen: the outgoing clip plus whatever was left of the previous gap
+        float outgoingValue = outgoing[joint][axis];
+        float outgoingVelocity = angleDifference(outgoing[joint][axis], outgoingPrevious[joint][axis]);
+        if (carryOver) {
+            outgoingValue += current[joint][axis];
+            outgoingVelocity += velocities[joint][axis];
+        }
+
+        // the polynomial is built for a positive gap, negative gaps are mirrored
+        const float x0 = angleDifference(outgoingValue, incoming[joint][axis]);
+        const float v0 = outgoingVelocity - angleDifference(incomingNext[joint][axis], incoming[joint][axis]);
+        const float sign = x0 < 0.0f ? -1.0f : 1.0f;
+        const float x = sign * x0;
+        float v = sign * v0;
+
+        float* terms = &coefficients[TERMS * channel];
+        float t1 = static_cast<float>(frames);
+        if (x < 1e-6f) {
+            std::fill(terms, terms + TERMS, 0.0f);
+            durations[channel] = 0.0f;
+            continue;
+        }
+
+        // a gap that is widening is not allowed to overshoot, one closing fast finishes early
+        if (v > 0.0f) {
+            v = 0.0f;
+        } else if (v < 0.0f) {
+            t1 = std::min(t1, -5.0f * x / v);
+        }
+        const float a0 = std::max(0.0f, (-8.0f * v * t1 - 20.0f * x) / (t1 * t1));
+
+        const float t2 = t1 * t1;
+        terms[0] = sign * x;
+        terms[1] = sign * v;
+        terms[2] = sign * a0 / 2.0f;
+        terms[3] = sign * -(3.0f * a0 * t2 + 12.0f * v * t1 + 20.0f * x) / (2.0f * t2 * t1);
+        terms[4] = sign * (3.0f * a0 * t2 + 16.0f * v * t1 + 30.0f * x) / (2.0f * t2 * t2);
+        terms[5] = sign * -(a0 * t2 + 6.0f * v * t1 + 12.0f * x) / (2.0f * t2 * t2 * t1);
+        durations[channel] = t1;
+    }
+
+    current.resize(joints);
+    velocities.resize(joints);
+    elapsed = 0;
+    length = frames;
+    evaluate(0.0f);
+}
+
+void Inertialization::cancel() {
+    elapsed = 0;
+    length = 0;
+}
+
+bool Inertialization::active() const {
+    return elapsed < length;
+}
+
+void Inertialization::advance() {
+    if (!active()) {
+        return;
+    }
+
+    elapsed++;
+    if (active()) {
+        evaluate(static_cast<float>(elapsed));
+    }
+}
+
+const Cartesian3* Inertialization::offsets() const {
+    return active() ? current.data() : nullptr;
+}
+
+int Inertialization::remainingFrames() const {
+    return length - elapsed;
+}
+
+void Inertialization::evaluate(const float t) {
+    for (size_t channel = 0; channel < durations.size(); channel++) {
+        const size_t joint = channel / 3;
+        const int axis = channel % 3;
+
+        if (t >= durations[channel]) {
+            current[joint][axis] = 0.0f;
+            velocities[joint][axis] = 0.0f;
+            continue;
+        }
+
+        const float* terms = &coefficients[TERMS * channel];
+        current[joint][axis] =
+                ((((terms[5] * t + terms[4]) * t + terms[3]) * t + terms[2]) * t + terms[1]) * t + terms[0];
+        velocities[joint][axis] =
+                (((5.0f * terms[5] * t + 4.0f * terms[4]) * t + 3.0f * terms[3]) * t + 2.0f * terms[2]) * t + terms[1];
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef INERTIALIZATION_H
+#define INERTIALIZATION_H
+
+#include <vector>
+
+#include "BVH.h"
+#include "Cartesian3.h"
+
+// Transition between clips that only ever evaluates the incoming clip
+// At the switch, the gap between the outgoing and incoming local rotations and between their rates of change is
+// recorded, then decayed to zero with a quintic polynomial while the incoming clip plays (Bollo, GDC 2018)
+class Inertialization {
+public:
+    Inertialization();
+
+    // switches from from at fromFrame to to at toFrame, the gap is gone after frames frames
+    // starting while active carries the remaining offsets over into the new gap
+    // clips on different skeletons have no joint-by-joint gap, the transition is cancelled and the switch is a cut
+    void start(const BVH& from, int fromFrame, const BVH& to, int toFrame, int frames);
+
+    void cancel();
+
+    bool active() const;
+
+    // moves on by one frame, the transition ends once its frames have passed
+    void advance();
+
+    // per joint, degrees to add to the incoming clip's local rotations this frame
+    // nullptr when not active
+    const Cartesian3* offsets() const;
+
+    // frames until the gap is closed
+    int remainingFrames() const;
+
+private:
+    // offset and rate of change of every channel at the current frame
+    void evaluate(float t);
+
+    // per channel x0, v0, a0 / 2, C, B, A of x(t) = A t^5 + B t^4 + C t^3 + a0 / 2 t^2 + v0 t + x0
+    std::vector<float> coefficients;
+    // per channel, frames the polynomial takes to reach zero
+    std::vector<float> durations;
+
+    std::vector<Cartesian3> current;
+    std::vector<Cartesian3> velocities;
+
+    // room for the four poses a start samples, see BVH::rotations
+    std::vector<Cartesian3> scratch;
+
+    int elapsed;
+    int length;
+};
+
+#endif
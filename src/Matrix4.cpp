@@ -96,47 +96,47 @@ Matrix4 Matrix4::translation(const Cartesian3& vector) {
     return result;
 }
 
-Matrix4 Matrix4::rotationX(const float degrees) {
-    // convert angle from degrees to radians
-    const float theta = DEG2RAD(degrees);
+Matrix4 Matrix4::rotationX(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
 
     Matrix4 result = identity();
 
     // set only the four coefficients affected
-    result.coordinates[1][1] = std::cos(theta);
-    result.coordinates[1][2] = std::sin(theta);
-    result.coordinates[2][1] = -std::sin(theta);
-    result.coordinates[2][2] = std::cos(theta);
+    result.coordinates[1][1] = cosine;
+    result.coordinates[1][2] = sine;
+    result.coordinates[2][1] = -sine;
+    result.coordinates[2][2] = cosine;
 
     return result;
 }
 
-Matrix4 Matrix4::rotationY(const float degrees) {
-    // convert angle from degrees to radians
-    const float theta = DEG2RAD(degrees);
+Matrix4 Matrix4::rotationY(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
 
     Matrix4 result = identity();
 
     // set only the four coefficients affected
-    result.coordinates[0][0] = std::cos(theta);
-    result.coordinates[0][2] = -std::sin(theta);
-    result.coordinates[2][0] = std::sin(theta);
-    result.coordinates[2][2] = std::cos(theta);
+    result.coordinates[0][0] = cosine;
+    result.coordinates[0][2] = -sine;
+    result.coordinates[2][0] = sine;
+    result.coordinates[2][2] = cosine;
 
     return result;
 }
 
-Matrix4 Matrix4::rotationZ(const float degrees) {
-    // convert angle from degrees to radians
-    const float theta = DEG2RAD(degrees);
+Matrix4 Matrix4::rotationZ(const float degrees, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(degrees, precision, sine, cosine);
 
     Matrix4 result = identity();
 
     // set only the four coefficients affected
-    result.coordinates[0][0] = std::cos(theta);
-    result.coordinates[0][1] = std::sin(theta);
-    result.coordinates[1][0] = -std::sin(theta);
-    result.coordinates[1][1] = std::cos(theta);
+    result.coordinates[0][0] = cosine;
+    result.coordinates[0][1] = sine;
+    result.coordinates[1][0] = -sine;
+    result.coordinates[1][1] = cosine;
 
     return result;
 }
@@ -2,6 +2,7 @@
 #define MATRIX4_H
 
 #include "Cartesian3.h"
+#include "FastMath.h"
 #include "Homogeneous4.h"
 
 #define DEG2RAD(x) (M_PI*(float)(x)/180.0)
@@ -32,11 +33,12 @@ public:
 
     static Matrix4 translation(const Cartesian3& vector);
 
-    static Matrix4 rotationX(float degrees);
+    // Precision::Fast trades exactness for fastSinCos, see FastMath.h for its error
+    static Matrix4 rotationX(float degrees, Precision precision = Precision::Exact);
 
-    static Matrix4 rotationY(float degrees);
+    static Matrix4 rotationY(float degrees, Precision precision = Precision::Exact);
 
-    static Matrix4 rotationZ(float degrees);
+    static Matrix4 rotationZ(float degrees, Precision precision = Precision::Exact);
 
     static Matrix4 rotateBetween(const Cartesian3& vector1, const Cartesian3& vector2);
 };
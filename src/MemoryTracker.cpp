@@ -0,0 +1,236 @@
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+namespace {
+    constexpr int subsystemCount = static_cast<int>(MemorySubsystem::Count);
+
+    // Every block is prefixed with a header recording its size and owner
+    // 16 bytes keeps the returned pointer at the default new alignment
+    struct alignas(16) BlockHeader {
+        std::size_t size;
+        int subsystem;
+    };
+
+    struct SubsystemCounters {
+        std::atomic<std::size_t> allocations{0};
+        std::atomic<std::size_t> deallocations{0};
+        std::atomic<std::size_t> liveBytes{0};
+        std::atomic<std::size_t> peakBytes{0};
+        std::atomic<std::size_t> totalBytes{0};
+    };
+
+    // constant-initialised, so safe to touch from allocations made during static initialisation
+    SubsystemCounters counters[subsystemCount];
+
+    thread_local int currentSubsystem = static_cast<int>(MemorySubsystem::Other);
+    thread_local std::size_t threadAllocations = 0;
+    thread_local std::size_t tickStart = 0;
+
+    std::atomic<std::size_t> lastTick{0};
+    std::atomic<std::size_t> tickAllocations{0};
+    std::atomic<std::size_t> ticks{0};
+    std::atomic<bool> strictTicks{false};
+    std::atomic<unsigned int> strictWarmup{0};
+
+    void* trackedAllocate(const std::size_t size) {
+        void* block = std::malloc(sizeof(BlockHeader) + size);
+        if (block == nullptr) {
+            return nullptr;
+        }
+
+        BlockHeader* header = static_cast<BlockHeader*>(block);
+        header->size = size;
+        header->subsystem = currentSubsystem;
+
+        SubsystemCounters& owner = counters[header->subsystem];
+        owner.allocations.fetch_add(1, std::memory_order_relaxed);
+        owner.totalBytes.fetch_add(size, std::memory_order_relaxed);
+        const std::size_t live = owner.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = owner.peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !owner.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+
+        threadAllocations++;
+        return header + 1;
+    }
+
+    void trackedFree(void* pointer) {
+        if (pointer == nullptr) {
+            return;
+        }
+
+        BlockHeader* header = static_cast<BlockHeader*>(pointer) - 1;
+        SubsystemCounters& owner = counters[header->subsystem];
+        owner.deallocations.fetch_add(1, std::memory_order_relaxed);
+        owner.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+        std::free(header);
+    }
+
+    void* throwingAllocate(const std::size_t size) {
+        void* pointer = trackedAllocate(size);
+        if (pointer == nullptr) {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+}
+
+MemoryStats MemoryTracker::stats(const MemorySubsystem subsystem) {
+    const SubsystemCounters& source = counters[static_cast<int>(subsystem)];
+
+    MemoryStats result;
+    result.allocations = source.allocations.load(std::memory_order_relaxed);
+    result.deallocations = source.deallocations.load(std::memory_order_relaxed);
+    result.liveBytes = source.liveBytes.load(std::memory_order_relaxed);
+    result.peakBytes = source.peakBytes.load(std::memory_order_relaxed);
+    result.totalBytes = source.totalBytes.load(std::memory_order_relaxed);
+    return result;
+}
+
+MemoryStats MemoryTracker::total() {
+    MemoryStats result;
+    for (int subsystem = 0; subsystem < subsystemCount; subsystem++) {
+        const MemoryStats partial = stats(static_cast<MemorySubsystem>(subsystem));
+        result.allocations += partial.allocations;
+        result.deallocations += partial.deallocations;
+        result.liveBytes += partial.liveBytes;
+        result.peakBytes += partial.peakBytes;
+        result.totalBytes += partial.totalBytes;
+    }
+    return result;
+}
+
+const char* MemoryTracker::name(const MemorySubsystem subsystem) {
+    switch (subsystem) {
+        case MemorySubsystem::Parser:
+            return "parser";
+        case MemorySubsystem::ClipStorage:
+            return "clip storage";
+        case MemorySubsystem::Blending:
+            return "blending";
+        case MemorySubsystem::Terrain:
+            return "terrain";
+        case MemorySubsystem::Rendering:
+            return "rendering";
+        default:
+            return "other";
+    }
+}
+
+void MemoryTracker::beginTick() {
+    tickStart = threadAllocations;
+}
+
+void MemoryTracker::endTick() {
+    const std::size_t allocations = threadAllocations - tickStart;
+    const std::size_t tick = ticks.fetch_add(1, std::memory_order_relaxed) + 1;
+    lastTick.store(allocations, std::memory_order_relaxed);
+    tickAllocations.fetch_add(allocations, std::memory_order_relaxed);
+
+    if (allocations > 0 &&
+        strictTicks.load(std::memory_order_relaxed) &&
+        tick > strictWarmup.load(std::memory_order_relaxed)) {
+        std::cerr << "Steady-state tick " << tick << " performed " << allocations << " allocation(s)" << std::endl;
+        report(std::cerr);
+        std::abort();
+    }
+}
+
+std::size_t MemoryTracker::lastTickAllocations() {
+    return lastTick.load(std::memory_order_relaxed);
+}
+
+double MemoryTracker::allocationsPerTick() {
+    const std::size_t tickCount = ticks.load(std::memory_order_relaxed);
+    if (tickCount == 0) {
+        return 0.0;
+    }
+    return tickAllocations.load(std::memory_order_relaxed) / static_cast<double>(tickCount);
+}
+
+void MemoryTracker::setStrictTicks(const bool enabled, const unsigned int warmupTicks) {
+    strictWarmup.store(warmupTicks, std::memory_order_relaxed);
+    strictTicks.store(enabled, std::memory_order_relaxed);
+}
+
+void MemoryTracker::report(std::ostream& outStream) {
+    outStream << std::left << std::setw(14) << "subsystem"
+              << std::right << std::setw(12) << "allocs"
+              << std::setw(12) << "frees"
+              << std::setw(14) << "live bytes"
+              << std::setw(14) << "peak bytes"
+              << std::setw(16) << "total bytes" << "\n";
+
+    for (int subsystem = 0; subsystem < subsystemCount; subsystem++) {
+        const MemorySubsystem id = static_cast<MemorySubsystem>(subsystem);
+        const MemoryStats s = stats(id);
+        outStream << std::left << std::setw(14) << name(id)
+                  << std::right << std::setw(12) << s.allocations
+                  << std::setw(12) << s.deallocations
+                  << std::setw(14) << s.liveBytes
+                  << std::setw(14) << s.peakBytes
+                  << std::setw(16) << s.totalBytes << "\n";
+    }
+
+    outStream << "ticks: " << ticks.load(std::memory_order_relaxed)
+              << ", allocations last tick: " << lastTickAllocations()
+              << ", allocations per tick: " << allocationsPerTick() << std::endl;
+}
+
+MemoryScope::MemoryScope(const MemorySubsystem subsystem)
+    : previous(static_cast<MemorySubsystem>(currentSubsystem)) {
+    currentSubsystem = static_cast<int>(subsystem);
+}
+
+MemoryScope::~MemoryScope() {
+    currentSubsystem = static_cast<int>(previous);
+}
+
+/**
+ * Replacements of the global allocation functions.
+ * The aligned overloads are left to the standard library, they never see tracked blocks.
+ */
+void* operator new(const std::size_t size) {
+    return throwingAllocate(size);
+}
+
+void* operator new[](const std::size_t size) {
+    return throwingAllocate(size);
+}
+
+void* operator new(const std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](const std::size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    trackedFree(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    trackedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    trackedFree(pointer);
+}
@@ -0,0 +1,63 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstddef>
+#include <iostream>
+
+// Subsystems heap allocations are attributed to
+// Allocations made outside any MemoryScope are counted as Other
+enum class MemorySubsystem {
+    Parser, ClipStorage, Blending, Terrain, Rendering, Other, Count
+};
+
+struct MemoryStats {
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+    std::size_t liveBytes = 0;
+    std::size_t peakBytes = 0;
+    std::size_t totalBytes = 0;
+};
+
+// Counts every global operator new/delete, per subsystem and per update tick
+class MemoryTracker {
+public:
+    static MemoryStats stats(MemorySubsystem subsystem);
+
+    // aggregate of all subsystems, peak is the sum of per-subsystem peaks
+    static MemoryStats total();
+
+    static const char* name(MemorySubsystem subsystem);
+
+    // brackets one update tick on the calling thread
+    // only allocations made by that thread are counted towards the tick
+    static void beginTick();
+
+    static void endTick();
+
+    static std::size_t lastTickAllocations();
+
+    static double allocationsPerTick();
+
+    // In strict mode, any tick after the warm-up that allocates aborts the program
+    // Used to keep the steady-state update loop allocation-free
+    static void setStrictTicks(bool enabled, unsigned int warmupTicks = 24);
+
+    static void report(std::ostream& outStream);
+};
+
+// Attributes allocations made by the current thread to a subsystem while in scope
+class MemoryScope {
+public:
+    explicit MemoryScope(MemorySubsystem subsystem);
+
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemorySubsystem previous;
+};
+
+#endif
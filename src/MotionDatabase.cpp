@@ -0,0 +1,323 @@
+#include "MotionDatabase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include "PoseEvaluator.h"
+
+// feature groups: [first dimension, end) and how much they count in a match
+struct FeatureGroup {
+    int begin;
+    int end;
+    float weight;
+};
+
+constexpr std::array<FeatureGroup, 3> featureGroups{{
+    {0, 6, 1.0f},                    // foot positions
+    {6, 12, 1.0f},                   // foot velocities
+    {12, FEATURE_DIMENSIONS, 2.0f}   // future trajectory, weighted up so input is followed
+}};
+
+constexpr int CLUSTER_ITERATIONS = 8;
+
+MotionDatabase::MotionDatabase(): means{}, scales{}, visited(0) {
+}
+
+void MotionDatabase::addClip(const BVH& clip, const float inPlaceSpeed) {
+    clips.push_back(&clip);
+    inPlaceSpeeds.push_back(inPlaceSpeed);
+}
+
+void MotionDatabase::build() {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
+
+    std::vector<float> features;
+    clipOffsets.clear();
+    for (size_t clip = 0; clip < clips.size(); clip++) {
+        clipOffsets.push_back(features.size() / FEATURE_DIMENSIONS);
+        computeFeatures(clip, features);
+    }
+
+    normalise(features);
+    buildClusters(features);
+}
+
+bool MotionDatabase::empty() const {
+    return rowClips.empty();
+}
+
+std::size_t MotionDatabase::size() const {
+    return rowClips.size();
+}
+
+int MotionDatabase::clipIndex(const BVH* clip) const {
+    const auto found = std::find(clips.begin(), clips.end(), clip);
+    return found == clips.end() ? -1 : static_cast<int>(found - clips.begin());
+}
+
+const BVH* MotionDatabase::clip(const int index) const {
+    return clips[index];
+}
+
+MotionMatch MotionDatabase::search(const int clip,
+                                   const int frame,
+                                   const std::array<Cartesian3, TRAJECTORY_SAMPLES>& trajectory) const {
+    MotionMatch match;
+    visited = 0;
+    if (empty()) {
+        return match;
+    }
+
+    // the pose half of the query is the current frame's row, only the trajectory is new
+    alignas(16) float query[FEATURE_STRIDE] = {};
+    if (clip >= 0) {
+        const size_t entry = clipOffsets[clip] + frame % clips[clip]->frameCount;
+        std::copy_n(&rows[FEATURE_STRIDE * entryRows[entry]], FEATURE_STRIDE, query);
+    }
+    for (int sample = 0; sample < TRAJECTORY_SAMPLES; sample++) {
+        const int dimension = featureGroups[2].begin + 2 * sample;
+        query[dimension] = (trajectory[sample].x - means[dimension]) * scales[dimension];
+        query[dimension + 1] = (trajectory[sample].y - means[dimension + 1]) * scales[dimension + 1];
+    }
+
+    // visit clusters nearest first, skipping those that cannot hold anything closer than the best so far
+    const size_t clusterCount = radii.size();
+    float* centroidDistances = FrameArena::local().allocateArray<float>(clusterCount);
+    int* order = FrameArena::local().allocateArray<int>(clusterCount);
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        centroidDistances[cluster] = std::sqrt(squaredDistance(query, &centroids[FEATURE_STRIDE * cluster]));
+        order[cluster] = cluster;
+    }
+    std::sort(order, order + clusterCount, [centroidDistances](const int a, const int b) {
+        return centroidDistances[a] < centroidDistances[b];
+    });
+
+    float best = std::numeric_limits<float>::max();
+    size_t bestRow = 0;
+    for (size_t i = 0; i < clusterCount; i++) {
+        const int cluster = order[i];
+        // triangle inequality: every row in the cluster is at least this far from the query
+        const float bound = centroidDistances[cluster] - radii[cluster];
+        if (bound > 0.0f && bound * bound >= best) {
+            continue;
+        }
+
+        for (size_t row = clusterStarts[cluster]; row < clusterStarts[cluster + 1]; row++) {
+            const float distance = squaredDistance(query, &rows[FEATURE_STRIDE * row]);
+            if (distance < best) {
+                best = distance;
+                bestRow = row;
+            }
+        }
+        visited += clusterStarts[cluster + 1] - clusterStarts[cluster];
+    }
+
+    match.clip = rowClips[bestRow];
+    match.frame = rowFrames[bestRow];
+    match.cost = best;
+    return match;
+}
+
+std::size_t MotionDatabase::lastVisited() const {
+    return visited;
+}
+
+void MotionDatabase::computeFeatures(const std::size_t clip, std::vector<float>& features) const {
+    const BVH& animation = *clips[clip];
+    const int frameCount = animation.frameCount;
+    const std::vector<LegChain>& legs = animation.skeleton->legs;
+
+    // model-space foot positions at BVH scale, the root is never translated so they are root-relative
+    std::vector<Cartesian3> feet(2 * frameCount);
+    PoseEvaluator evaluator;
+    for (int frame = 0; frame < frameCount; frame++) {
+        evaluator.evaluate(animation, frame, 1.0f);
+        for (size_t foot = 0; foot < 2 && foot < legs.size(); foot++) {
+            feet[2 * frame + foot] = evaluator.jointMatrices()[legs[foot].ankle].origin();
+        }
+    }
+
+    // per-frame root displacement, clips authored in place move forward at their given speed
+    const RootMotionTrack& rootMotion = animation.rootMotion();
+    std::vector<Cartesian3> deltas(frameCount, Cartesian3(0.0f, inPlaceSpeeds[clip], 0.0f));
+    if (!rootMotion.inPlace()) {
+        for (int frame = 0; frame < frameCount; frame++) {
+            deltas[frame] = Cartesian3(rootMotion.deltas[2 * frame], rootMotion.deltas[2 * frame + 1], 0.0f);
+        }
+    }
+
+    for (int frame = 0; frame < frameCount; frame++) {
+        // the last frame has no successor, it differences backwards instead
+        const int next = std::min(frame + 1, frameCount - 1);
+        const int previous = next == frame ? std::max(frame - 1, 0) : frame;
+
+        for (int foot = 0; foot < 2; foot++) {
+            const Cartesian3& position = feet[2 * frame + foot];
+            features.insert(features.end(), {position.x, position.y, position.z});
+        }
+        for (int foot = 0; foot < 2; foot++) {
+            const Cartesian3 velocity = feet[2 * next + foot] - feet[2 * previous + foot];
+            features.insert(features.end(), {velocity.x, velocity.y, velocity.z});
+        }
+
+        // playback loops, so the trajectory wraps around the clip
+        Cartesian3 position;
+        for (int step = 0; step < TRAJECTORY_SAMPLES * TRAJECTORY_STEP; step++) {
+            position = position + deltas[(frame + step) % frameCount];
+            if ((step + 1) % TRAJECTORY_STEP == 0) {
+                features.insert(features.end(), {position.x, position.y});
+            }
+        }
+    }
+}
+
+void MotionDatabase::normalise(std::vector<float>& features) {
+    const size_t entries = features.size() / FEATURE_DIMENSIONS;
+    if (entries == 0) {
+        return;
+    }
+
+    means.fill(0.0f);
+    for (size_t entry = 0; entry < entries; entry++) {
+        for (int dimension = 0; dimension < FEATURE_DIMENSIONS; dimension++) {
+            means[dimension] += features[FEATURE_DIMENSIONS * entry + dimension];
+        }
+    }
+    for (float& mean : means) {
+        mean /= entries;
+    }
+
+    // one deviation per group keeps the relative scale of x, y and z within it
+    for (const FeatureGroup& group : featureGroups) {
+        double variance = 0.0;
+        for (size_t entry = 0; entry < entries; entry++) {
+            for (int dimension = group.begin; dimension < group.end; dimension++) {
+                const float difference = features[FEATURE_DIMENSIONS * entry + dimension] - means[dimension];
+                variance += difference * difference;
+            }
+        }
+        const float deviation = std::sqrt(variance / (entries * (group.end - group.begin)));
+        for (int dimension = group.begin; dimension < group.end; dimension++) {
+            scales[dimension] = group.weight / std::max(deviation, 1e-6f);
+        }
+    }
+
+    for (size_t entry = 0; entry < entries; entry++) {
+        for (int dimension = 0; dimension < FEATURE_DIMENSIONS; dimension++) {
+            float& value = features[FEATURE_DIMENSIONS * entry + dimension];
+            value = (value - means[dimension]) * scales[dimension];
+        }
+    }
+}
+
+void MotionDatabase::buildClusters(const std::vector<float>& features) {
+    const size_t entries = features.size() / FEATURE_DIMENSIONS;
+    const size_t clusterCount = std::max<size_t>(1, std::lround(std::sqrt(entries)));
+
+    // padded copy of the features so the distance kernel can be used throughout
+    std::vector<float> padded(FEATURE_STRIDE * entries, 0.0f);
+    for (size_t entry = 0; entry < entries; entry++) {
+        std::copy_n(&features[FEATURE_DIMENSIONS * entry], FEATURE_DIMENSIONS, &padded[FEATURE_STRIDE * entry]);
+    }
+
+    // k-means, seeded with entries spread evenly over the clips
+    centroids.assign(FEATURE_STRIDE * clusterCount, 0.0f);
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        const size_t seed = cluster * entries / clusterCount;
+        std::copy_n(&padded[FEATURE_STRIDE * seed], FEATURE_STRIDE, &centroids[FEATURE_STRIDE * cluster]);
+    }
+
+    std::vector<int> assignment(entries, 0);
+    std::vector<size_t> members(clusterCount);
+    for (int iteration = 0; iteration < CLUSTER_ITERATIONS; iteration++) {
+        for (size_t entry = 0; entry < entries; entry++) {
+            float best = std::numeric_limits<float>::max();
+            for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+                const float distance = squaredDistance(&padded[FEATURE_STRIDE * entry],
+                                                       &centroids[FEATURE_STRIDE * cluster]);
+                if (distance < best) {
+                    best = distance;
+                    assignment[entry] = cluster;
+                }
+            }
+        }
+
+        // an emptied cluster keeps its previous centroid
+        std::vector<float> sums(FEATURE_STRIDE * clusterCount, 0.0f);
+        std::fill(members.begin(), members.end(), 0);
+        for (size_t entry = 0; entry < entries; entry++) {
+            members[assignment[entry]]++;
+            for (int dimension = 0; dimension < FEATURE_STRIDE; dimension++) {
+                sums[FEATURE_STRIDE * assignment[entry] + dimension] += padded[FEATURE_STRIDE * entry + dimension];
+            }
+        }
+        for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+            if (members[cluster] == 0) {
+                continue;
+            }
+            for (int dimension = 0; dimension < FEATURE_STRIDE; dimension++) {
+                centroids[FEATURE_STRIDE * cluster + dimension] =
+                        sums[FEATURE_STRIDE * cluster + dimension] / members[cluster];
+            }
+        }
+    }
+
+    // lay the rows out cluster by cluster so each search scans contiguous memory
+    clusterStarts.assign(clusterCount + 1, 0);
+    for (size_t entry = 0; entry < entries; entry++) {
+        clusterStarts[assignment[entry] + 1]++;
+    }
+    for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+        clusterStarts[cluster + 1] += clusterStarts[cluster];
+    }
+
+    rows.assign(FEATURE_STRIDE * entries, 0.0f);
+    rowClips.resize(entries);
+    rowFrames.resize(entries);
+    entryRows.resize(entries);
+    radii.assign(clusterCount, 0.0f);
+    std::vector<size_t> next(clusterStarts.begin(), clusterStarts.end() - 1);
+    for (size_t clip = 0, entry = 0; clip < clips.size(); clip++) {
+        for (int frame = 0; frame < clips[clip]->frameCount; frame++, entry++) {
+            const int cluster = assignment[entry];
+            const size_t row = next[cluster]++;
+            std::copy_n(&padded[FEATURE_STRIDE * entry], FEATURE_STRIDE, &rows[FEATURE_STRIDE * row]);
+            rowClips[row] = clip;
+            rowFrames[row] = frame;
+            entryRows[entry] = row;
+
+            const float distance = std::sqrt(squaredDistance(&rows[FEATURE_STRIDE * row],
+                                                             &centroids[FEATURE_STRIDE * cluster]));
+            radii[cluster] = std::max(radii[cluster], distance);
+        }
+    }
+}
+
+float MotionDatabase::squaredDistance(const float* a, const float* b) {
+#if defined(__SSE__)
+    __m128 sum = _mm_setzero_ps();
+    for (int dimension = 0; dimension < FEATURE_STRIDE; dimension += 4) {
+        const __m128 difference = _mm_sub_ps(_mm_loadu_ps(a + dimension), _mm_loadu_ps(b + dimension));
+        sum = _mm_add_ps(sum, _mm_mul_ps(difference, difference));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, sum);
+#else
+    // four independent lanes, the same shape the compiler can vectorise
+    float lanes[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int dimension = 0; dimension < FEATURE_STRIDE; dimension += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            const float difference = a[dimension + lane] - b[dimension + lane];
+            lanes[lane] += difference * difference;
+        }
+    }
+#endif
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
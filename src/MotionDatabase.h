@@ -0,0 +1,90 @@
+#ifndef MOTION_DATABASE_H
+#define MOTION_DATABASE_H
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+#include "Cartesian3.h"
+
+// future root positions in the query, TRAJECTORY_STEP frames apart
+constexpr int TRAJECTORY_SAMPLES = 3;
+constexpr int TRAJECTORY_STEP = 10;
+
+// two feet positions and velocities, then the horizontal trajectory
+constexpr int FEATURE_DIMENSIONS = 2 * 3 + 2 * 3 + 2 * TRAJECTORY_SAMPLES;
+// rows are padded to whole 4-float lanes for the distance kernel
+constexpr int FEATURE_STRIDE = (FEATURE_DIMENSIONS + 3) / 4 * 4;
+
+// Best continuation found by a search
+struct MotionMatch {
+    int clip = -1;
+    int frame = 0;
+    float cost = 0.0f;
+};
+
+// Every frame of a set of clips described by foot and trajectory features,
+// normalised and stored contiguously, with a cluster index for nearest-frame search
+class MotionDatabase {
+public:
+    MotionDatabase();
+
+    // inPlaceSpeed is the forward speed, in BVH units per frame, played clips authored in place are moved at
+    void addClip(const BVH& clip, float inPlaceSpeed = 0.0f);
+
+    // computes the features of every added clip, normalises them and clusters the frames
+    void build();
+
+    bool empty() const;
+
+    std::size_t size() const;
+
+    // index of clip in the order added, -1 if it is not in the database
+    int clipIndex(const BVH* clip) const;
+
+    const BVH* clip(int index) const;
+
+    // frame of the database closest to the pose of clip at frame continuing along trajectory
+    // trajectory holds the wanted future root positions relative to the character, in BVH units
+    MotionMatch search(int clip, int frame, const std::array<Cartesian3, TRAJECTORY_SAMPLES>& trajectory) const;
+
+    // rows compared by the last search, the rest were pruned by the cluster index
+    std::size_t lastVisited() const;
+
+private:
+    // raw features of one frame
+    void computeFeatures(std::size_t clip, std::vector<float>& features) const;
+
+    void normalise(std::vector<float>& features);
+
+    void buildClusters(const std::vector<float>& features);
+
+    static float squaredDistance(const float* a, const float* b);
+
+    std::vector<const BVH*> clips;
+    std::vector<float> inPlaceSpeeds;
+    // first entry of each clip, entries are numbered clip after clip
+    std::vector<std::size_t> clipOffsets;
+
+    // per dimension, features are stored as (value - mean) * scale
+    std::array<float, FEATURE_DIMENSIONS> means;
+    std::array<float, FEATURE_DIMENSIONS> scales;
+
+    // FEATURE_STRIDE floats per row, rows sorted by cluster
+    std::vector<float> rows;
+    std::vector<int> rowClips;
+    std::vector<int> rowFrames;
+    // entry -> row
+    std::vector<std::size_t> entryRows;
+
+    // rows [clusterStarts[i], clusterStarts[i + 1]) belong to cluster i
+    std::vector<std::size_t> clusterStarts;
+    std::vector<float> centroids;
+    std::vector<float> radii;
+
+    mutable std::size_t visited;
+};
+
+#endif
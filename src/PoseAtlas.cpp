@@ -0,0 +1,200 @@
+#include "PoseAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "BinaryIO.h"
+#include "MemoryTracker.h"
+#include "PoseEvaluator.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#ifndef GL_RGBA32F
+#define GL_RGBA32F 0x8814
+#endif
+
+// identifies the binary atlas format and its revision
+constexpr std::uint32_t BINARY_ATLAS_MAGIC = 0x534c5441; // "ATLS"
+constexpr std::uint32_t BINARY_ATLAS_VERSION = 2;
+
+// texels per joint transform, one per stored row
+constexpr int MATRIX_TEXELS = 3;
+
+PoseAtlas::PoseAtlas(): rate(0.0f), bakedScale(0.0f), joints(0) {
+}
+
+void PoseAtlas::bake(const std::vector<const BVH*>& clips, const float sampleRate, const float scale) {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
+
+    rate = sampleRate;
+    bakedScale = scale;
+    joints = 0;
+    ranges.clear();
+    matrices.clear();
+
+    for (const BVH* clip : clips) {
+        joints = std::max<std::uint32_t>(joints, clip->skeleton->jointCount());
+    }
+
+    std::uint32_t rows = 0;
+    for (const BVH* clip : clips) {
+        const float duration = clip->frameCount * clip->frameDuration();
+        const std::uint32_t count = std::max(1, static_cast<int>(std::lround(duration * sampleRate)));
+        ranges.push_back(ClipRange{rows, count});
+        rows += count;
+    }
+    matrices.assign(static_cast<std::size_t>(rows) * joints, Affine3x4::identity());
+
+    PoseEvaluator evaluator;
+    for (size_t clip = 0; clip < clips.size(); clip++) {
+        const BVH& source = *clips[clip];
+        for (std::uint32_t sample = 0; sample < ranges[clip].count; sample++) {
+            const float time = sample / sampleRate;
+            const int frame = static_cast<int>(std::lround(time / source.frameDuration())) % source.frameCount;
+            evaluator.evaluate(source, frame, scale);
+
+            const std::vector<Affine3x4>& evaluated = evaluator.jointMatrices();
+            std::copy(evaluated.begin(), evaluated.end(),
+                      matrices.begin() + static_cast<std::size_t>(ranges[clip].first + sample) * joints);
+        }
+    }
+}
+
+bool PoseAtlas::writeFile(const char* fileName, const std::uint64_t key) const {
+    std::ofstream outFile(fileName, std::ios::binary);
+    if (!outFile) {
+        return false;
+    }
+
+    writeValue(outFile, BINARY_ATLAS_MAGIC);
+    writeValue(outFile, BINARY_ATLAS_VERSION);
+    writeValue(outFile, key);
+    writeValue(outFile, rate);
+    writeValue(outFile, bakedScale);
+    writeValue(outFile, joints);
+    writeArray(outFile, ranges);
+    writeArray(outFile, matrices);
+
+    return static_cast<bool>(outFile);
+}
+
+bool PoseAtlas::readFile(const char* fileName, const std::uint64_t key) {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
+
+    std::ifstream inFile(fileName, std::ios::binary);
+    if (!inFile) {
+        return false;
+    }
+
+    std::uint32_t magic = 0, version = 0;
+    std::uint64_t storedKey = 0;
+    if (!readValue(inFile, magic) || magic != BINARY_ATLAS_MAGIC ||
+        !readValue(inFile, version) || version != BINARY_ATLAS_VERSION ||
+        !readValue(inFile, storedKey) || storedKey != key) {
+        return false;
+    }
+
+    float storedRate = 0.0f, storedScale = 0.0f;
+    std::uint32_t storedJoints = 0;
+    std::vector<ClipRange> storedRanges;
+    std::vector<Affine3x4> storedMatrices;
+    if (!readValue(inFile, storedRate) ||
+        !readValue(inFile, storedScale) ||
+        !readValue(inFile, storedJoints) ||
+        !readArray(inFile, storedRanges) ||
+        !readArray(inFile, storedMatrices)) {
+        return false;
+    }
+
+    // reject truncated or inconsistent files rather than reading past the matrices
+    std::size_t rows = 0;
+    for (const ClipRange& range : storedRanges) {
+        if (range.count == 0 || range.first != rows) {
+            return false;
+        }
+        rows += range.count;
+    }
+    if (storedMatrices.size() != rows * storedJoints) {
+        return false;
+    }
+
+    rate = storedRate;
+    bakedScale = storedScale;
+    joints = storedJoints;
+    ranges = std::move(storedRanges);
+    matrices = std::move(storedMatrices);
+    return true;
+}
+
+bool PoseAtlas::empty() const {
+    return ranges.empty();
+}
+
+std::size_t PoseAtlas::clipCount() const {
+    return ranges.size();
+}
+
+std::size_t PoseAtlas::sampleCount() const {
+    return joints == 0 ? 0 : matrices.size() / joints;
+}
+
+std::size_t PoseAtlas::jointCount() const {
+    return joints;
+}
+
+float PoseAtlas::sampleRate() const {
+    return rate;
+}
+
+float PoseAtlas::scale() const {
+    return bakedScale;
+}
+
+std::size_t PoseAtlas::bytes() const {
+    return matrices.size() * sizeof(Affine3x4) + ranges.size() * sizeof(ClipRange);
+}
+
+const Affine3x4* PoseAtlas::pose(const int clip, const float time) const {
+    const ClipRange& range = ranges[clip];
+    int sample = static_cast<int>(time * rate) % static_cast<int>(range.count);
+    if (sample < 0) {
+        sample += range.count;
+    }
+    return matrices.data() + static_cast<std::size_t>(range.first + sample) * joints;
+}
+
+std::size_t PoseAtlas::firstSample(const int clip) const {
+    return ranges[clip].first;
+}
+
+unsigned int PoseAtlas::upload() const {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    const std::size_t width = static_cast<std::size_t>(joints) * MATRIX_TEXELS;
+    const std::size_t height = sampleCount();
+    if (empty() || width > static_cast<std::size_t>(maxSize) || height > static_cast<std::size_t>(maxSize)) {
+        return 0;
+    }
+
+    // Affine3x4 rows are aligned Vec4s, so the transforms of a sample are already consecutive texels
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, matrices.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
@@ -0,0 +1,68 @@
+#ifndef POSE_ATLAS_H
+#define POSE_ATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "BVH.h"
+
+// Model-space joint transforms of whole clips, baked at a fixed sample rate
+// One row per sample and one column per joint, clips follow each other row-wise
+// Playback is a single lookup, no forward kinematics at runtime
+class PoseAtlas {
+public:
+    PoseAtlas();
+
+    // samples every clip at sampleRate samples per second, taking the nearest source frame
+    // columns past a clip's own joints are left as identity
+    void bake(const std::vector<const BVH*>& clips, float sampleRate, float scale);
+
+    // key identifies what the atlas was baked from, reading fails when it does not match
+    bool writeFile(const char* fileName, std::uint64_t key) const;
+
+    bool readFile(const char* fileName, std::uint64_t key);
+
+    bool empty() const;
+
+    // clips are numbered in bake order
+    std::size_t clipCount() const;
+
+    std::size_t sampleCount() const;
+
+    std::size_t jointCount() const;
+
+    float sampleRate() const;
+
+    float scale() const;
+
+    std::size_t bytes() const;
+
+    // joint transforms of clip at time seconds, wrapping around the clip
+    const Affine3x4* pose(int clip, float time) const;
+
+    // first row of clip, for samplers that index the texture directly
+    std::size_t firstSample(int clip) const;
+
+    // uploads the atlas as a GL_RGBA32F texture for skinning in a shader
+    // each transform is 3 texels wide, one texel per row, the bottom row is always (0, 0, 0, 1)
+    // and each sample is one texel row
+    // needs a current GL context, returns the texture name or 0 when the atlas is too large
+    unsigned int upload() const;
+
+private:
+    struct ClipRange {
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    float rate;
+    float bakedScale;
+    std::uint32_t joints;
+    std::vector<ClipRange> ranges;
+    // row-major samples x joints
+    std::vector<Affine3x4> matrices;
+};
+
+#endif
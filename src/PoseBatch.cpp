@@ -0,0 +1,107 @@
+#include "PoseBatch.h"
+
+#include <algorithm>
+#include <chrono>
+
+// passes over every character, each one a frame further into its clip
+constexpr int BENCHMARK_PASSES = 20;
+// every path is timed this many times and the fastest run kept, so a busy machine does not decide the comparison
+constexpr int BENCHMARK_REPEATS = 5;
+
+// frame of character in a pass, spread out so neighbouring characters rarely share a pose
+static int benchmarkFrame(const std::size_t character, const int pass) {
+    return static_cast<int>(37 * character) + pass;
+}
+
+// characters per second of the fastest of BENCHMARK_REPEATS runs of evaluatePass over every pass
+template <typename EvaluatePass>
+static double fastestRate(const std::size_t characters, const EvaluatePass& evaluatePass) {
+    double fastest = 0.0;
+    for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < BENCHMARK_PASSES; pass++) {
+            evaluatePass(pass);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        fastest = std::max(fastest, BENCHMARK_PASSES * characters / elapsed.count());
+    }
+    return fastest;
+}
+
+// what PoseBatch computes for one character: fast trig and every joint, none skipped for being unchanged
+static void evaluateScalar(const BVH& clip, const int frame, const float scale, Cartesian3* scratch, Affine3x4* out) {
+    const Skeleton& skeleton = *clip.skeleton;
+    const Cartesian3* rotations = clip.rotations(frame, scratch);
+    const Affine3x4 rootMatrix = BVH::modelMatrix();
+    for (size_t joint = 0; joint < skeleton.jointCount(); joint++) {
+        const int parent = skeleton.parentBones[joint];
+        const Affine3x4& parentMatrix = parent < 0 ? rootMatrix : out[parent];
+        out[joint] = parentMatrix *
+                     BVH::localMatrix(scale * skeleton.boneTranslations[joint], rotations[joint], Precision::Fast);
+    }
+}
+
+template <int Lanes>
+static double benchmarkLanes(const std::vector<const BVH*>& clips,
+                             const std::size_t characters,
+                             const float scale,
+                             std::vector<std::vector<Affine3x4>>& poses) {
+    PoseBatch<Lanes> batch;
+    const BVH* batchClips[Lanes];
+    int batchFrames[Lanes];
+    Affine3x4* batchPoses[Lanes];
+
+    return fastestRate(characters, [&](const int pass) {
+        for (std::size_t first = 0; first < characters; first += Lanes) {
+            const int count = static_cast<int>(std::min<std::size_t>(Lanes, characters - first));
+            for (int lane = 0; lane < count; lane++) {
+                batchClips[lane] = clips[(first + lane) % clips.size()];
+                batchFrames[lane] = benchmarkFrame(first + lane, pass);
+                batchPoses[lane] = poses[first + lane].data();
+            }
+
+            batch.evaluate(*clips.front()->skeleton, scale, 0, batchClips, batchFrames, count);
+            batch.extractAll(batchPoses);
+        }
+    });
+}
+
+void benchmarkPoseBatch(const std::vector<const BVH*>& clips,
+                        const std::size_t characters,
+                        const float scale,
+                        std::ostream& outStream) {
+    // lanes share a skeleton, clips on another one are left out
+    std::vector<const BVH*> shared;
+    for (const BVH* clip : clips) {
+        if (clip->skeleton == clips.front()->skeleton) {
+            shared.push_back(clip);
+        }
+    }
+    if (shared.empty() || characters == 0) {
+        outStream << "pose batch benchmark: no clips loaded" << std::endl;
+        return;
+    }
+
+    const std::size_t jointCount = shared.front()->skeleton->jointCount();
+    std::vector<std::vector<Affine3x4>> poses(characters, std::vector<Affine3x4>(jointCount));
+
+    // the same work and precision as the batches, one character at a time
+    std::vector<Cartesian3> scratch(jointCount);
+    const double scalar = fastestRate(characters, [&](const int pass) {
+        for (std::size_t character = 0; character < characters; character++) {
+            evaluateScalar(*shared[character % shared.size()], benchmarkFrame(character, pass), scale, scratch.data(),
+                           poses[character].data());
+        }
+    });
+
+    outStream << "pose evaluation, " << characters << " characters of " << jointCount << " joints, "
+              << shared.size() << " clips, fast trig, every joint\n";
+    outStream << "  scalar:   " << scalar << " characters/s\n";
+    for (const auto& lanes : {std::make_pair(4, benchmarkLanes<4>(shared, characters, scale, poses)),
+                              std::make_pair(8, benchmarkLanes<8>(shared, characters, scale, poses)),
+                              std::make_pair(16, benchmarkLanes<16>(shared, characters, scale, poses))}) {
+        outStream << "  " << lanes.first << " lanes: " << (lanes.first < 10 ? " " : "") << lanes.second
+                  << " characters/s, " << lanes.second / scalar << "x" << "\n";
+    }
+    outStream.flush();
+}
@@ -0,0 +1,181 @@
+#ifndef POSE_BATCH_H
+#define POSE_BATCH_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "Affine3x4.h"
+#include "BVH.h"
+#include "FastMath.h"
+#include "Skeleton.h"
+
+// Forward kinematics for Lanes characters at once, all sharing one skeleton but free to play different clips and frames
+// Joint data is laid out array of structures of arrays: per joint, each of the 12 affine coefficients holds one float
+// per lane, so the skeleton is walked once and every step along a bone chain is the same arithmetic on Lanes floats
+// Lanes is a multiple of 4 so the lane loops map onto whole SIMD registers
+// Crowds are evaluated with fastSinCos, its error is far below what a distant character shows
+template <int Lanes>
+class PoseBatch {
+    static_assert(Lanes > 0 && Lanes % 4 == 0, "lanes must fill whole SIMD registers");
+
+public:
+    static constexpr int LANES = Lanes;
+
+    // evaluates count <= Lanes characters, clips[lane] at frames[lane], into model space (see BVH::modelMatrix)
+    // every clip must use skeleton, joints outside its mask for lod are skipped
+    void evaluate(const Skeleton& skeleton, float scale, int lod, const BVH* const* clips, const int* frames, int count) {
+        const size_t jointCount = skeleton.jointCount();
+        blocks.resize(jointCount);
+        mask = skeleton.lodMasks[lod].data();
+        lanes = count;
+
+        // unused lanes repeat the first one, so every lane loop runs over whole registers
+        scratch.resize(Lanes * jointCount);
+        const Cartesian3* laneRotations[Lanes];
+        for (int lane = 0; lane < Lanes; lane++) {
+            laneRotations[lane] =
+                    lane < count ? clips[lane]->rotations(frames[lane], &scratch[lane * jointCount]) : laneRotations[0];
+        }
+
+        const Affine3x4 rootMatrix = BVH::modelMatrix();
+        JointBlock root;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 4; column++) {
+                for (int lane = 0; lane < Lanes; lane++) {
+                    root.m[4 * row + column][lane] = rootMatrix[row][column];
+                }
+            }
+        }
+
+        const std::vector<int>& parentBones = skeleton.parentBones;
+        const std::vector<Cartesian3>& boneTranslations = skeleton.boneTranslations;
+        for (size_t joint = 0; joint < jointCount; joint++) {
+            if (!mask[joint]) {
+                continue;
+            }
+
+            // sines and cosines of the local rotation, one per lane, all three axes in one vectorised pass
+            // axis by axis in flat arrays, the pass runs over all of them as one
+            alignas(64) float angles[3 * Lanes];
+            alignas(64) float sines[3 * Lanes];
+            alignas(64) float cosines[3 * Lanes];
+            for (int axis = 0; axis < 3; axis++) {
+                for (int lane = 0; lane < Lanes; lane++) {
+                    angles[axis * Lanes + lane] = laneRotations[lane][joint][axis] * DEGREES_TO_RADIANS;
+                }
+            }
+            fastSinCos(angles, sines, cosines, 3 * Lanes);
+
+            const int parent = parentBones[joint];
+            const JointBlock& p = parent < 0 ? root : blocks[parent];
+            JointBlock& out = blocks[joint];
+            const Cartesian3 translation = scale * boneTranslations[joint];
+
+            for (int lane = 0; lane < Lanes; lane++) {
+                const float sx = sines[lane], cx = cosines[lane];
+                const float sy = sines[Lanes + lane], cy = cosines[Lanes + lane];
+                const float sz = sines[2 * Lanes + lane], cz = cosines[2 * Lanes + lane];
+
+                // the rotation of BVH::localMatrix
+                const float local[3][3] = {
+                    {cy * cz, -cy * sz, sy},
+                    {cx * sz + sx * sy * cz, cx * cz - sx * sy * sz, -sx * cy},
+                    {sx * sz - cx * sy * cz, sx * cz + cx * sy * sz, cx * cy}
+                };
+
+                // parent * local, both affine, so the bottom row is never stored
+                for (int row = 0; row < 3; row++) {
+                    const float p0 = p.m[4 * row][lane];
+                    const float p1 = p.m[4 * row + 1][lane];
+                    const float p2 = p.m[4 * row + 2][lane];
+                    out.m[4 * row][lane] = p0 * local[0][0] + p1 * local[1][0] + p2 * local[2][0];
+                    out.m[4 * row + 1][lane] = p0 * local[0][1] + p1 * local[1][1] + p2 * local[2][1];
+                    out.m[4 * row + 2][lane] = p0 * local[0][2] + p1 * local[1][2] + p2 * local[2][2];
+                    out.m[4 * row + 3][lane] =
+                            p0 * translation.x + p1 * translation.y + p2 * translation.z + p.m[4 * row + 3][lane];
+                }
+            }
+        }
+    }
+
+    // number of characters evaluated by the last call
+    int count() const {
+        return lanes;
+    }
+
+    // copies the joint transforms of lane out in the layout of PoseEvaluator::jointMatrices
+    // joints skipped by the mask are left as they were
+    void extract(const int lane, Affine3x4* out) const {
+        for (size_t joint = 0; joint < blocks.size(); joint++) {
+            if (!mask[joint]) {
+                continue;
+            }
+
+            const JointBlock& block = blocks[joint];
+            Affine3x4& matrix = out[joint];
+            for (int row = 0; row < 3; row++) {
+                for (int column = 0; column < 4; column++) {
+                    matrix[row][column] = block.m[4 * row + column][lane];
+                }
+            }
+        }
+    }
+
+    // extract for every lane, lane into outs[lane] for lane < count()
+    // a row of four lanes is four rows of the lanes' matrices transposed, so with SSE it is done in registers
+    void extractAll(Affine3x4* const* outs) const {
+        int lane = 0;
+#if defined(__SSE__)
+        for (; lane + 4 <= lanes; lane += 4) {
+            for (size_t joint = 0; joint < blocks.size(); joint++) {
+                if (!mask[joint]) {
+                    continue;
+                }
+
+                const JointBlock& block = blocks[joint];
+                for (int row = 0; row < 3; row++) {
+                    __m128 first = _mm_load_ps(&block.m[4 * row][lane]);
+                    __m128 second = _mm_load_ps(&block.m[4 * row + 1][lane]);
+                    __m128 third = _mm_load_ps(&block.m[4 * row + 2][lane]);
+                    __m128 fourth = _mm_load_ps(&block.m[4 * row + 3][lane]);
+                    _MM_TRANSPOSE4_PS(first, second, third, fourth);
+                    _mm_store_ps(&outs[lane][joint][row][0], first);
+                    _mm_store_ps(&outs[lane + 1][joint][row][0], second);
+                    _mm_store_ps(&outs[lane + 2][joint][row][0], third);
+                    _mm_store_ps(&outs[lane + 3][joint][row][0], fourth);
+                }
+            }
+        }
+#endif
+        for (; lane < lanes; lane++) {
+            extract(lane, outs[lane]);
+        }
+    }
+
+private:
+    // a joint's Affine3x4, row-major, one float per lane
+    struct alignas(64) JointBlock {
+        float m[12][Lanes];
+    };
+
+    std::vector<JointBlock> blocks;
+    // per lane, room for clips that compute their rotations, see BVH::rotations
+    std::vector<Cartesian3> scratch;
+    const unsigned char* mask = nullptr;
+    int lanes = 0;
+};
+
+// lanes PoseCache evaluates together
+constexpr int POSE_BATCH_LANES = 8;
+
+// times forward kinematics of characters characters cycling through clips at scattered frames, one at a time and
+// Lanes at a time through PoseBatch, both with fastSinCos and every joint, and prints characters per second
+void benchmarkPoseBatch(const std::vector<const BVH*>& clips, std::size_t characters, float scale,
+                        std::ostream& outStream);
+
+#endif
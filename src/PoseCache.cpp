@@ -0,0 +1,154 @@
+#include "PoseCache.h"
+
+#include <algorithm>
+#include <functional>
+
+constexpr std::size_t INITIAL_BUCKETS = 64;
+
+PoseCache::PoseCache(const int phaseQuantum)
+    : quantum(std::max(phaseQuantum, 1)),
+      buckets(INITIAL_BUCKETS, -1),
+      tickHits(0),
+      tickRequests(0),
+      hits(0),
+      requests(0) {
+}
+
+void PoseCache::beginTick() {
+    entries.clear();
+    pending.clear();
+    std::fill(buckets.begin(), buckets.end(), -1);
+    tickHits = 0;
+    tickRequests = 0;
+}
+
+const Affine3x4* PoseCache::pose(const BVH& clip, const int frame, const float scale, const int lod) {
+    const int entry = request(clip, frame, scale, lod);
+    evaluatePending();
+    return entryPose(entry).data();
+}
+
+int PoseCache::request(const BVH& clip, const int frame, const float scale, const int lod) {
+    const int index = frame % clip.frameCount;
+    const int key = index - index % quantum;
+    tickRequests++;
+    requests++;
+
+    int& found = bucket(&clip, key, lod, scale);
+    if (found >= 0) {
+        tickHits++;
+        hits++;
+        return found;
+    }
+
+    // keep the load factor under a half, rehashing is rare once the crowd settles
+    if (2 * (entries.size() + 1) > buckets.size()) {
+        buckets.assign(2 * buckets.size(), -1);
+        for (size_t entry = 0; entry < entries.size(); entry++) {
+            const Entry& existing = entries[entry];
+            bucket(existing.clip, existing.frame, existing.lod, existing.scale) = entry;
+        }
+    }
+
+    const int slot = entries.size();
+    if (slot == static_cast<int>(slots.size())) {
+        slots.emplace_back();
+        evaluated.push_back(Entry{nullptr, -1, -1, 0.0f});
+    }
+    entries.push_back(Entry{&clip, key, lod, scale});
+    bucket(&clip, key, lod, scale) = slot;
+
+    // a slot still holding this pose from an earlier tick needs no work
+    if (!(evaluated[slot] == entries[slot])) {
+        pending.push_back(slot);
+    }
+    return slot;
+}
+
+void PoseCache::evaluatePending() {
+    // entries that can share a batch end up next to each other
+    std::sort(pending.begin(), pending.end(), [this](const int a, const int b) {
+        const Entry& first = entries[a];
+        const Entry& second = entries[b];
+        if (first.clip->skeleton != second.clip->skeleton) {
+            return std::less<const Skeleton*>()(first.clip->skeleton.get(), second.clip->skeleton.get());
+        }
+        if (first.lod != second.lod) {
+            return first.lod < second.lod;
+        }
+        return first.scale < second.scale;
+    });
+
+    const BVH* clips[POSE_BATCH_LANES];
+    int frames[POSE_BATCH_LANES];
+    for (size_t first = 0; first < pending.size();) {
+        const Entry& group = entries[pending[first]];
+        const Skeleton& skeleton = *group.clip->skeleton;
+
+        int count = 0;
+        while (count < POSE_BATCH_LANES && first + count < pending.size()) {
+            const Entry& entry = entries[pending[first + count]];
+            if (entry.clip->skeleton.get() != &skeleton || entry.lod != group.lod || entry.scale != group.scale) {
+                break;
+            }
+            clips[count] = entry.clip;
+            frames[count] = entry.frame;
+            count++;
+        }
+
+        batch.evaluate(skeleton, group.scale, group.lod, clips, frames, count);
+        Affine3x4* outs[POSE_BATCH_LANES];
+        for (int lane = 0; lane < count; lane++) {
+            const int slot = pending[first + lane];
+            slots[slot].resize(skeleton.jointCount());
+            outs[lane] = slots[slot].data();
+            evaluated[slot] = entries[slot];
+        }
+        batch.extractAll(outs);
+        first += count;
+    }
+    pending.clear();
+}
+
+const std::vector<Affine3x4>& PoseCache::entryPose(const int entry) const {
+    return slots[entry];
+}
+
+void PoseCache::setPhaseQuantum(const int phaseQuantum) {
+    quantum = std::max(phaseQuantum, 1);
+}
+
+int PoseCache::phaseQuantum() const {
+    return quantum;
+}
+
+std::size_t PoseCache::poseCount() const {
+    return entries.size();
+}
+
+float PoseCache::tickHitRate() const {
+    return tickRequests == 0 ? 0.0f : tickHits / static_cast<float>(tickRequests);
+}
+
+float PoseCache::hitRate() const {
+    return requests == 0 ? 0.0f : hits / static_cast<float>(requests);
+}
+
+int& PoseCache::bucket(const BVH* clip, const int frame, const int lod, const float scale) {
+    std::size_t hash = std::hash<const BVH*>()(clip);
+    hash = hash * 31 + static_cast<std::size_t>(frame);
+    hash = hash * 31 + static_cast<std::size_t>(lod);
+
+    // linear probing, the table is a power of two in size
+    const std::size_t mask = buckets.size() - 1;
+    for (std::size_t probe = hash & mask;; probe = (probe + 1) & mask) {
+        const int entry = buckets[probe];
+        if (entry < 0) {
+            return buckets[probe];
+        }
+        const Entry& existing = entries[entry];
+        if (existing.clip == clip && existing.frame == frame && existing.lod == lod && existing.scale == scale) {
+            return buckets[probe];
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef POSE_CACHE_H
+#define POSE_CACHE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "BVH.h"
+#include "PoseBatch.h"
+
+// Model-space poses shared by every character playing the same clip, frame and detail in a tick
+// Characters only add their own root transform on top
+// Poses are evaluated together once every request of the tick is in, POSE_BATCH_LANES at a time
+class PoseCache {
+public:
+    // frames are rounded down to multiples of phaseQuantum, so nearby phases share a pose
+    explicit PoseCache(int phaseQuantum = 1);
+
+    // forgets the poses of the previous tick, their storage is kept
+    void beginTick();
+
+    // pose of clip at frame, evaluated straight away along with any pending requests
+    // valid until the next beginTick
+    const Affine3x4* pose(const BVH& clip, int frame, float scale, int lod);
+
+    // entry that will hold the pose of clip at frame, entries are numbered from 0 in each tick
+    // the pose is only evaluated by the next evaluatePending
+    int request(const BVH& clip, int frame, float scale, int lod);
+
+    // evaluates the poses requested since the last call, batching entries that share a skeleton, scale and detail
+    void evaluatePending();
+
+    // joint transforms of an entry of this tick, once evaluated
+    const std::vector<Affine3x4>& entryPose(int entry) const;
+
+    void setPhaseQuantum(int phaseQuantum);
+
+    int phaseQuantum() const;
+
+    // distinct poses evaluated this tick
+    std::size_t poseCount() const;
+
+    // requests served from the cache, over the last tick and since construction
+    float tickHitRate() const;
+
+    float hitRate() const;
+
+private:
+    struct Entry {
+        const BVH* clip;
+        int frame;
+        int lod;
+        float scale;
+
+        bool operator ==(const Entry& other) const {
+            return clip == other.clip && frame == other.frame && lod == other.lod && scale == other.scale;
+        }
+    };
+
+    // open addressing over entries, -1 marks a free bucket
+    int& bucket(const BVH* clip, int frame, int lod, float scale);
+
+    int quantum;
+
+    std::vector<Entry> entries;
+    std::vector<int> buckets;
+    // joint transforms of each entry, reused in the same order every tick
+    std::vector<std::vector<Affine3x4>> slots;
+    // what each slot was last evaluated from, steady crowds often ask for the same pose again
+    std::vector<Entry> evaluated;
+    // entries requested but not evaluated yet
+    std::vector<int> pending;
+    PoseBatch<POSE_BATCH_LANES> batch;
+
+    std::size_t tickHits;
+    std::size_t tickRequests;
+    std::size_t hits;
+    std::size_t requests;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "PoseEvaluator.h"
+
+#include <cmath>
+
+PoseEvaluator::PoseEvaluator(const float epsilon)
+    : epsilon(epsilon),
+      clip(nullptr),
+      skeleton(nullptr),
+      frameIndex(-1),
+      scale(0.0f),
+      lod(0),
+      valid(false),
+      offset(false),
+      recomputed(0) {
+}
+
+bool PoseEvaluator::evaluate(const BVH& clip,
+                             const int frame,
+                             const float scale,
+                             const int lod,
+                             const Cartesian3* rotationOffsets) {
+    const int index = frame % clip.frameCount;
+    recomputed = 0;
+
+    // same clip, frame, scale and detail: the pose cannot have changed
+    if (valid && !offset && rotationOffsets == nullptr &&
+        &clip == this->clip && index == frameIndex && scale == this->scale && lod == this->lod) {
+        return false;
+    }
+
+    // a different skeleton or scale invalidates every cached transform,
+    // a different detail level may bring back joints that were left stale
+    const Skeleton& clipSkeleton = *clip.skeleton;
+    if (&clipSkeleton != skeleton || scale != this->scale || lod != this->lod) {
+        valid = false;
+    }
+
+    const size_t jointCount = clipSkeleton.jointCount();
+    if (!valid) {
+        localRotations.resize(jointCount);
+        scratch.resize(jointCount);
+        matrices.resize(jointCount);
+        dirty.resize(jointCount);
+    }
+
+    const Cartesian3* rotations = clip.rotations(index, scratch.data());
+    const std::vector<int>& parentBones = clipSkeleton.parentBones;
+    const std::vector<Cartesian3>& boneTranslations = clipSkeleton.boneTranslations;
+    const std::vector<unsigned char>& mask = clipSkeleton.lodMasks[lod];
+    const Affine3x4 rootMatrix = BVH::modelMatrix();
+
+    // parents precede their children, so one pass propagates dirtiness down the hierarchy
+    for (size_t joint = 0; joint < jointCount; joint++) {
+        if (!mask[joint]) {
+            dirty[joint] = 0;
+            continue;
+        }
+
+        const Cartesian3 rotation = rotationOffsets == nullptr ? rotations[joint] : rotations[joint] + rotationOffsets[joint];
+        const Cartesian3& previous = localRotations[joint];
+        const bool changed = !valid ||
+                             std::fabs(rotation.x - previous.x) > epsilon ||
+                             std::fabs(rotation.y - previous.y) > epsilon ||
+                             std::fabs(rotation.z - previous.z) > epsilon;
+
+        const int parent = parentBones[joint];
+        dirty[joint] = changed || (parent >= 0 && dirty[parent]);
+        if (!dirty[joint]) {
+            continue;
+        }
+
+        // rotations within epsilon are kept as they were, so error never accumulates beyond epsilon
+        if (changed) {
+            localRotations[joint] = rotation;
+        }
+
+        const Affine3x4& parentMatrix = parent < 0 ? rootMatrix : matrices[parent];
+        matrices[joint] = parentMatrix * BVH::localMatrix(scale * boneTranslations[joint], localRotations[joint]);
+        recomputed++;
+    }
+
+    this->clip = &clip;
+    this->skeleton = &clipSkeleton;
+    this->frameIndex = index;
+    this->scale = scale;
+    this->lod = lod;
+    valid = true;
+    offset = rotationOffsets != nullptr;
+
+    return recomputed > 0;
+}
+
+void PoseEvaluator::invalidate() {
+    valid = false;
+}
+
+const std::vector<Affine3x4>& PoseEvaluator::jointMatrices() const {
+    return matrices;
+}
+
+std::size_t PoseEvaluator::recomputedJoints() const {
+    return recomputed;
+}
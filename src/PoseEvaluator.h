@@ -0,0 +1,54 @@
+#ifndef POSE_EVALUATOR_H
+#define POSE_EVALUATOR_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "BVH.h"
+#include "Cartesian3.h"
+
+// Per-character forward kinematics that only recomputes what changed
+// A joint is dirty when its local rotation moved by more than epsilon degrees since
+// the last evaluation, or when its parent is dirty. Clean subtrees keep their transforms.
+class PoseEvaluator {
+public:
+    explicit PoseEvaluator(float epsilon = 0.01f);
+
+    // evaluates clip at frame into model space (see BVH::modelMatrix)
+    // joints outside the skeleton's mask for lod are skipped and left stale
+    // rotationOffsets, when given, are added to the clip's local rotations, one per joint (see Inertialization)
+    // returns false when the pose is unchanged, in which case no work was done
+    bool evaluate(const BVH& clip, int frame, float scale, int lod = 0, const Cartesian3* rotationOffsets = nullptr);
+
+    // forces a full evaluation next time, needed when a clip's data changes in place
+    void invalidate();
+
+    // model-space transform per joint, empty until the first evaluation
+    const std::vector<Affine3x4>& jointMatrices() const;
+
+    // joints recomputed by the last evaluation
+    std::size_t recomputedJoints() const;
+
+private:
+    float epsilon;
+
+    // what the cached transforms were computed from
+    const BVH* clip;
+    const Skeleton* skeleton;
+    int frameIndex;
+    float scale;
+    int lod;
+    bool valid;
+    // the cached transforms include rotation offsets, the frame alone does not identify them
+    bool offset;
+
+    std::vector<Cartesian3> localRotations;
+    // room for clips that compute their rotations, see BVH::rotations
+    std::vector<Cartesian3> scratch;
+    std::vector<Affine3x4> matrices;
+    std::vector<unsigned char> dirty;
+    std::size_t recomputed;
+};
+
+#endif
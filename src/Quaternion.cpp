@@ -1,20 +1,22 @@
 #include "Quaternion.h"
 
 #include <cmath>
+#include <limits>
 
 Quaternion::Quaternion() {
     q[0] = q[1] = q[2] = 0.0;
     q[3] = 1.0;
 }
 
-Quaternion::Quaternion(const Cartesian3& axis, float theta) {
-    const float thetaRad = M_PI * theta / 180.0f;
-    Cartesian3 v = std::sin(thetaRad) * axis.unit();
+Quaternion::Quaternion(const Cartesian3& axis, const float theta, const Precision precision) {
+    float sine, cosine;
+    sinCosDegrees(theta, precision, sine, cosine);
+    Cartesian3 v = sine * axis.unit();
     q[0] = v[0];
     q[1] = v[1];
     q[2] = v[2];
 
-    q[3] = std::cos(thetaRad);
+    q[3] = cosine;
 }
 
 Matrix4 Quaternion::matrix() const {
@@ -130,20 +132,22 @@ std::ostream& operator<<(std::ostream& outStream, const Quaternion& quaternion)
  *      - q0 and q1 are unit Quaternions
  *      - t in [0..1]
  */
-Quaternion slerp(const Quaternion& q0, const Quaternion& q1, const float t) {
+Quaternion slerp(const Quaternion& q0, const Quaternion& q1, const float t, const Precision precision) {
     const float cosTheta = q0.dot(q1);
 
     // LERP when Quaternions are (close to) parallel
     // Avoids SLERP division by 0
-    if (cosTheta - 1.0f < std::numeric_limits<float>::epsilon()) {
+    if (1.0f - cosTheta < std::numeric_limits<float>::epsilon()) {
         return (1.0f - t) * q0 + t * q1;
     }
 
-    float angle = std::acos(cosTheta);
+    const float angle = acosOf(cosTheta, precision);
 
-    float d = std::sin(angle);
-    float s0 = std::sin((1.0f - t) * angle) / d;
-    float s1 = std::sin(t * angle) / d;
+    // only the sines are needed
+    float d, s0, s1, cosine;
+    sinCos(angle, precision, d, cosine);
+    sinCos((1.0f - t) * angle, precision, s0, cosine);
+    sinCos(t * angle, precision, s1, cosine);
 
-    return s0 * q0 + s1 * q1;
+    return (s0 / d) * q0 + (s1 / d) * q1;
 }
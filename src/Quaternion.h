@@ -2,6 +2,7 @@
 #define QUATERNION
 
 #include "Cartesian3.h"
+#include "FastMath.h"
 #include "Homogeneous4.h"
 #include "Matrix4.h"
 
@@ -14,7 +15,7 @@ public:
     Quaternion();
 
     // Quaternion that rotates (2 * theta) degrees around a given axis
-    Quaternion(const Cartesian3& axis, float theta);
+    Quaternion(const Cartesian3& axis, float theta, Precision precision = Precision::Exact);
 
     // Returns corresponding rotation matrix
     Matrix4 matrix() const;
@@ -30,6 +31,7 @@ Quaternion operator*(float scalar, const Quaternion& quat);
 
 std::ostream& operator<<(std::ostream& outStream, const Quaternion& quat);
 
-Quaternion slerp(const Quaternion& q0, const Quaternion& q1, float t);
+// Precision::Fast uses fastAcos and fastSinCos, see FastMath.h for their error
+Quaternion slerp(const Quaternion& q0, const Quaternion& q1, float t, Precision precision = Precision::Exact);
 
 #endif
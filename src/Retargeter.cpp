@@ -0,0 +1,333 @@
+#include "Retargeter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "ChannelLayout.h"
+
+// names of other common rigs (Poser, DAZ, 3ds Max biped) for the mixamo joints, after canonicalName
+static const std::pair<const char*, const char*> JOINT_ALIASES[] = {
+    {"hip", "hips"}, {"pelvis", "hips"}, {"abdomen", "spine"}, {"chest", "spine1"},
+    {"lcollar", "leftshoulder"}, {"lshldr", "leftarm"}, {"lforearm", "leftforearm"}, {"lhand", "lefthand"},
+    {"rcollar", "rightshoulder"}, {"rshldr", "rightarm"}, {"rforearm", "rightforearm"}, {"rhand", "righthand"},
+    {"lthigh", "leftupleg"}, {"lshin", "leftleg"}, {"lfoot", "leftfoot"},
+    {"rthigh", "rightupleg"}, {"rshin", "rightleg"}, {"rfoot", "rightfoot"}
+};
+
+using Rotation = std::array<double, 9>;
+
+static const Rotation IDENTITY = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+
+static Rotation multiply(const Rotation& left, const Rotation& right) {
+    Rotation result;
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            result[3 * row + column] = left[3 * row] * right[column] +
+                                       left[3 * row + 1] * right[3 + column] +
+                                       left[3 * row + 2] * right[6 + column];
+        }
+    }
+    return result;
+}
+
+// transpose(left) * right, the inverse of a rotation is its transpose
+static Rotation multiplyTransposed(const Rotation& left, const Rotation& right) {
+    Rotation result;
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            result[3 * row + column] = left[row] * right[column] +
+                                       left[3 + row] * right[3 + column] +
+                                       left[6 + row] * right[6 + column];
+        }
+    }
+    return result;
+}
+
+// smallest rotation taking the direction of from onto the direction of to
+static Rotation rotationBetween(const Cartesian3& from, const Cartesian3& to) {
+    if (from.length() < 1e-6f || to.length() < 1e-6f) {
+        return IDENTITY;
+    }
+
+    const Cartesian3 a = from.unit();
+    const Cartesian3 b = to.unit();
+    const Cartesian3 v = a.cross(b);
+    const double c = a.dot(b);
+
+    // opposite directions: half a turn about any axis perpendicular to them
+    if (c < -1.0 + 1e-6) {
+        Cartesian3 axis = a.cross(Cartesian3(1.0f, 0.0f, 0.0f));
+        if (axis.length() < 1e-3f) {
+            axis = a.cross(Cartesian3(0.0f, 1.0f, 0.0f));
+        }
+        axis = axis.unit();
+        Rotation result;
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                result[3 * row + column] = 2.0 * axis[row] * axis[column] - (row == column ? 1.0 : 0.0);
+            }
+        }
+        return result;
+    }
+
+    // Rodrigues: I + [v]x + [v]x^2 / (1 + c)
+    const double k = 1.0 / (1.0 + c);
+    return {
+        c + k * v.x * v.x, k * v.x * v.y - v.z, k * v.x * v.z + v.y,
+        k * v.y * v.x + v.z, c + k * v.y * v.y, k * v.y * v.z - v.x,
+        k * v.z * v.x - v.y, k * v.z * v.y + v.x, c + k * v.z * v.z
+    };
+}
+
+// rotation by radians about the unit axis
+static Rotation rotationAbout(const Cartesian3& axis, const double radians) {
+    const double c = std::cos(radians);
+    const double s = std::sin(radians);
+    const double t = 1.0 - c;
+    return {
+        c + t * axis.x * axis.x, t * axis.x * axis.y - s * axis.z, t * axis.x * axis.z + s * axis.y,
+        t * axis.y * axis.x + s * axis.z, c + t * axis.y * axis.y, t * axis.y * axis.z - s * axis.x,
+        t * axis.z * axis.x - s * axis.y, t * axis.z * axis.y + s * axis.x, c + t * axis.z * axis.z
+    };
+}
+
+static Cartesian3 transform(const Rotation& rotation, const Cartesian3& vector) {
+    return Cartesian3(rotation[0] * vector.x + rotation[1] * vector.y + rotation[2] * vector.z,
+                      rotation[3] * vector.x + rotation[4] * vector.y + rotation[5] * vector.z,
+                      rotation[6] * vector.x + rotation[7] * vector.y + rotation[8] * vector.z);
+}
+
+// rotation taking the target bones (from) onto the source bones (to) of a joint
+// the first pair fixes the bone's direction, a second one, when there is one, the twist about it
+static Rotation boneCorrection(const std::vector<Cartesian3>& from, const std::vector<Cartesian3>& to) {
+    const Rotation aligned = rotationBetween(from[0], to[0]);
+    if (from.size() < 2 || to[0].length() < 1e-6f) {
+        return aligned;
+    }
+
+    const Cartesian3 axis = to[0].unit();
+    const Cartesian3 turned = transform(aligned, from[1]);
+    const Cartesian3 p = turned - turned.dot(axis) * axis;
+    const Cartesian3 q = to[1] - to[1].dot(axis) * axis;
+    if (p.length() < 1e-6f || q.length() < 1e-6f) {
+        return aligned;
+    }
+    return multiply(rotationAbout(axis, std::atan2(axis.dot(p.cross(q)), p.dot(q))), aligned);
+}
+
+static Rotation eulerRotation(const Cartesian3& angles) {
+    double matrix[3][3];
+    eulerToMatrix(RotationOrder::XYZ, angles, matrix);
+    return {
+        matrix[0][0], matrix[0][1], matrix[0][2],
+        matrix[1][0], matrix[1][1], matrix[1][2],
+        matrix[2][0], matrix[2][1], matrix[2][2]
+    };
+}
+
+static Cartesian3 rotationAngles(const Rotation& rotation, const Cartesian3& near) {
+    const double matrix[3][3] = {
+        {rotation[0], rotation[1], rotation[2]},
+        {rotation[3], rotation[4], rotation[5]},
+        {rotation[6], rotation[7], rotation[8]}
+    };
+    return matrixToEuler(RotationOrder::XYZ, matrix, near);
+}
+
+// hip to ankle at rest, 0 when the legs were not found
+static float legLength(const Skeleton& skeleton) {
+    if (skeleton.legs.empty()) {
+        return 0.0f;
+    }
+    const LegChain& leg = skeleton.legs.front();
+    return skeleton.boneTranslations[leg.knee].length() + skeleton.boneTranslations[leg.ankle].length();
+}
+
+// global rest-relative rotations of every source joint, parents first, then the target's local rotations from them
+static void retargetFrame(const std::vector<int>& sourceParents,
+                          const std::vector<int>& targetParents,
+                          const std::vector<int>& map,
+                          const std::vector<Rotation>& corrections,
+                          const Cartesian3* source,
+                          Cartesian3* target,
+                          const Cartesian3* previous,
+                          Rotation* sourceGlobal,
+                          Rotation* targetGlobal) {
+    for (size_t joint = 0; joint < sourceParents.size(); joint++) {
+        const Rotation local = eulerRotation(source[joint]);
+        const int parent = sourceParents[joint];
+        sourceGlobal[joint] = parent < 0 ? local : multiply(sourceGlobal[parent], local);
+    }
+
+    // target global = source global * correction, joints without a source do not turn relative to their parent
+    for (size_t joint = 0; joint < targetParents.size(); joint++) {
+        const int parent = targetParents[joint];
+        const int mapped = map[joint];
+        if (mapped >= 0) {
+            targetGlobal[joint] = multiply(sourceGlobal[mapped], corrections[joint]);
+        } else {
+            targetGlobal[joint] = parent < 0 ? IDENTITY : targetGlobal[parent];
+        }
+
+        const Rotation local = parent < 0 ? targetGlobal[joint] : multiplyTransposed(targetGlobal[parent],
+                                                                                      targetGlobal[joint]);
+        const Cartesian3 near = previous != nullptr ? previous[joint] : mapped >= 0 ? source[mapped] : Cartesian3();
+        target[joint] = rotationAngles(local, near);
+    }
+}
+
+Retargeter::Retargeter(): sourceHash(0), sourceJoints(0), scale(1.0f) {
+}
+
+bool Retargeter::build(const Skeleton& source, const std::shared_ptr<const Skeleton>& target) {
+    if (target == nullptr || source.jointCount() == 0 || target->jointCount() == 0) {
+        return false;
+    }
+
+    this->target = target;
+    sourceHash = source.hash;
+    sourceParents = source.parentBones;
+    sourceJoints = source.jointCount();
+
+    std::unordered_map<std::string, int> sourceByName;
+    for (size_t joint = 0; joint < source.jointCount(); joint++) {
+        sourceByName.emplace(canonicalName(source.boneNames[joint]), joint);
+    }
+
+    // the roots always correspond, whatever they are called
+    const size_t targetCount = target->jointCount();
+    map.assign(targetCount, -1);
+    map[0] = 0;
+    for (size_t joint = 1; joint < targetCount; joint++) {
+        const auto found = sourceByName.find(canonicalName(target->boneNames[joint]));
+        if (found != sourceByName.end() && found->second != 0) {
+            map[joint] = found->second;
+        }
+    }
+
+    // a joint's rest bones point at its matched children, on both skeletons
+    // the first one that is not parallel to it settles the twist, as a hand's fingers or the hips' legs do
+    const std::vector<Cartesian3> sourceRest = restPositions(source);
+    const std::vector<Cartesian3> targetRest = restPositions(*target);
+    corrections.assign(targetCount, IDENTITY);
+    std::vector<Cartesian3> targetBones, sourceBones;
+    for (size_t joint = 0; joint < targetCount; joint++) {
+        if (map[joint] < 0) {
+            continue;
+        }
+
+        targetBones.clear();
+        sourceBones.clear();
+        for (int child = joint + 1; child < target->subtreeEnds[joint] && targetBones.size() < 2; child++) {
+            if (target->parentBones[child] != static_cast<int>(joint) || map[child] < 0) {
+                continue;
+            }
+            const Cartesian3 targetBone = targetRest[child] - targetRest[joint];
+            const Cartesian3 sourceBone = sourceRest[map[child]] - sourceRest[map[joint]];
+            if (targetBone.length() < 1e-6f || sourceBone.length() < 1e-6f ||
+                (!targetBones.empty() && targetBone.unit().cross(targetBones[0].unit()).length() < 1e-3f)) {
+                continue;
+            }
+            targetBones.push_back(targetBone);
+            sourceBones.push_back(sourceBone);
+        }
+
+        // leaves turn like their parent
+        const int parent = target->parentBones[joint];
+        if (targetBones.empty()) {
+            corrections[joint] = parent < 0 ? IDENTITY : corrections[parent];
+            continue;
+        }
+        corrections[joint] = boneCorrection(targetBones, sourceBones);
+    }
+
+    const float sourceLegs = legLength(source);
+    const float targetLegs = legLength(*target);
+    scale = sourceLegs > 0.0f && targetLegs > 0.0f ? targetLegs / sourceLegs : 1.0f;
+    return true;
+}
+
+const std::vector<int>& Retargeter::jointMap() const {
+    return map;
+}
+
+std::size_t Retargeter::mappedJoints() const {
+    return map.size() - std::count(map.begin(), map.end(), -1);
+}
+
+float Retargeter::rootScale() const {
+    return scale;
+}
+
+bool Retargeter::retarget(const BVH& clip, BVH& result) const {
+    if (target == nullptr || clip.skeleton->hash != sourceHash || clip.skeleton->jointCount() != sourceJoints) {
+        return false;
+    }
+
+    std::vector<Cartesian3> sourceScratch(sourceJoints);
+    std::vector<Rotation> sourceGlobal(sourceJoints);
+    std::vector<Rotation> targetGlobal(map.size());
+    std::vector<Cartesian3> rotations(map.size());
+    std::vector<Cartesian3> previous(map.size());
+
+    std::vector<std::vector<float>> frames(clip.frameCount, std::vector<float>(target->frameChannels));
+    for (int frame = 0; frame < clip.frameCount; frame++) {
+        const Cartesian3* source = clip.rotations(frame, sourceScratch.data());
+        retargetFrame(sourceParents, target->parentBones, map, corrections, source, rotations.data(),
+                      frame > 0 ? previous.data() : nullptr, sourceGlobal.data(), targetGlobal.data());
+        encodeFrame(target->channelLayouts, rotations.data(), scale * clip.rootPosition(frame), frames[frame].data());
+        previous.swap(rotations);
+    }
+
+    return result.setFrames(target, std::move(frames), clip.frameDuration());
+}
+
+std::string Retargeter::canonicalName(const std::string& name) {
+    const size_t prefix = name.rfind(':');
+    std::string canonical;
+    for (size_t i = prefix == std::string::npos ? 0 : prefix + 1; i < name.size(); i++) {
+        const unsigned char c = name[i];
+        if (std::isalnum(c)) {
+            canonical.push_back(static_cast<char>(std::tolower(c)));
+        }
+    }
+
+    for (const auto& alias : JOINT_ALIASES) {
+        if (canonical == alias.first) {
+            return alias.second;
+        }
+    }
+    return canonical;
+}
+
+std::vector<Cartesian3> Retargeter::restPositions(const Skeleton& skeleton) {
+    std::vector<Cartesian3> positions(skeleton.jointCount());
+    for (size_t joint = 1; joint < positions.size(); joint++) {
+        positions[joint] = positions[skeleton.parentBones[joint]] + skeleton.boneTranslations[joint];
+    }
+    return positions;
+}
+
+RetargeterCache::RetargeterCache(std::shared_ptr<const Skeleton> target): target(std::move(target)) {
+}
+
+std::shared_ptr<const Retargeter> RetargeterCache::find(const std::shared_ptr<const Skeleton>& source) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : retargeters) {
+        if (entry.first->sameAs(*source)) {
+            return entry.second;
+        }
+    }
+
+    // failed builds are remembered too, as nullptr
+    std::shared_ptr<Retargeter> built = std::make_shared<Retargeter>();
+    if (!built->build(*source, target)) {
+        built = nullptr;
+    }
+    retargeters.emplace_back(source, built);
+    return built;
+}
@@ -0,0 +1,77 @@
+#ifndef RETARGETER_H
+#define RETARGETER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BVH.h"
+#include "Cartesian3.h"
+#include "Skeleton.h"
+
+// Plays clips recorded on one skeleton on another
+// Joints are matched once by name, ignoring namespace prefixes such as "mixamorig:", case and a few common aliases.
+// Bind-pose corrections are precomputed per joint, so that a bone that points another way at rest on the target
+// still follows the source bone, and retargeting a frame is then a single pass over the target's joints
+class Retargeter {
+public:
+    Retargeter();
+
+    // matches the joints of source to those of target and precomputes the corrections
+    // false when the roots do not match
+    bool build(const Skeleton& source, const std::shared_ptr<const Skeleton>& target);
+
+    // target joint -> source joint, -1 for joints that keep their bind pose
+    const std::vector<int>& jointMap() const;
+
+    std::size_t mappedJoints() const;
+
+    // source root positions, height included, are scaled by this to keep the target's feet from sliding,
+    // the ratio of leg lengths
+    float rootScale() const;
+
+    // every frame of clip on the target skeleton, laid out as its channels
+    // false when clip was not recorded on the source skeleton given to build
+    bool retarget(const BVH& clip, BVH& result) const;
+
+private:
+    using Rotation = std::array<double, 9>;
+
+    // lowercase, without namespace prefix, separators and with aliases resolved
+    static std::string canonicalName(const std::string& name);
+
+    // rest position of every joint, relative to the root
+    static std::vector<Cartesian3> restPositions(const Skeleton& skeleton);
+
+    std::shared_ptr<const Skeleton> target;
+    std::uint64_t sourceHash;
+    std::vector<int> sourceParents;
+    std::size_t sourceJoints;
+
+    std::vector<int> map;
+    // per target joint, the rotation taking its rest bone onto the direction of the source's
+    std::vector<Rotation> corrections;
+    float scale;
+};
+
+// Retargeters onto one target, built once per distinct source skeleton by whichever clip needs it first
+// Safe to use from any number of threads
+class RetargeterCache {
+public:
+    explicit RetargeterCache(std::shared_ptr<const Skeleton> target);
+
+    // the mapping from source onto the target, nullptr when their roots do not match
+    std::shared_ptr<const Retargeter> find(const std::shared_ptr<const Skeleton>& source);
+
+private:
+    std::shared_ptr<const Skeleton> target;
+    std::mutex mutex;
+    std::vector<std::pair<std::shared_ptr<const Skeleton>, std::shared_ptr<const Retargeter>>> retargeters;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#include "RootMotion.h"
+
+// Average net travel per frame under which a clip is considered in place, in BVH units
+constexpr float IN_PLACE_THRESHOLD = 0.5f;
+
+RootMotionTrack::RootMotionTrack(): stationary(true) {
+}
+
+void RootMotionTrack::extract(const std::vector<Cartesian3>& rootPositions) {
+    const size_t frames = rootPositions.size();
+    deltas.assign(2 * frames, 0.0f);
+
+    for (size_t frame = 0; frame + 1 < frames; frame++) {
+        const Cartesian3 delta = rootPositions[frame + 1] - rootPositions[frame];
+        deltas[2 * frame] = delta.x;
+        deltas[2 * frame + 1] = delta.y;
+    }
+
+    stationary = true;
+    if (frames < 2) {
+        return;
+    }
+
+    // wrapping around would teleport the root back to its start
+    deltas[2 * (frames - 1)] = deltas[2 * (frames - 2)];
+    deltas[2 * (frames - 1) + 1] = deltas[2 * (frames - 2) + 1];
+
+    // in place clips still sway about their start, only the net displacement tells them apart
+    Cartesian3 travelled = rootPositions[frames - 1] - rootPositions[0];
+    travelled.z = 0.0f;
+    stationary = travelled.length() / (frames - 1) < IN_PLACE_THRESHOLD;
+}
+
+void RootMotionTrack::clear() {
+    deltas.clear();
+    stationary = true;
+}
+
+bool RootMotionTrack::inPlace() const {
+    return stationary;
+}
+
+std::size_t RootMotionTrack::frameCount() const {
+    return deltas.size() / 2;
+}
+
+std::vector<Cartesian3> RootMotionTrack::positions() const {
+    std::vector<Cartesian3> result(frameCount());
+    for (size_t frame = 1; frame < result.size(); frame++) {
+        result[frame] = result[frame - 1] + Cartesian3(deltas[2 * frame - 2], deltas[2 * frame - 1], 0.0f);
+    }
+    return result;
+}
+
+void sampleRootMotion(const std::size_t count,
+                      const RootMotionTrack* const* tracks,
+                      const int* frames,
+                      const float* headingCos,
+                      const float* headingSin,
+                      const float scale,
+                      float* dx,
+                      float* dy) {
+    // gather the model-space deltas first, the rotation pass below is then a straight vector loop
+    for (size_t i = 0; i < count; i++) {
+        const RootMotionTrack& track = *tracks[i];
+        const size_t frameCount = track.frameCount();
+        if (frameCount == 0) {
+            dx[i] = dy[i] = 0.0f;
+            continue;
+        }
+        const size_t frame = frames[i] % frameCount;
+        dx[i] = track.deltas[2 * frame];
+        dy[i] = track.deltas[2 * frame + 1];
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const float x = dx[i];
+        const float y = dy[i];
+        dx[i] = scale * (headingCos[i] * x - headingSin[i] * y);
+        dy[i] = scale * (headingSin[i] * x + headingCos[i] * y);
+    }
+}
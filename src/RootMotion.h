@@ -0,0 +1,48 @@
+#ifndef ROOT_MOTION_H
+#define ROOT_MOTION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Cartesian3.h"
+
+// Horizontal root displacement of a clip, one (dx, dy) pair per frame
+// Stored in model space (Z up, Y forward, see BVH::modelMatrix) and unscaled
+class RootMotionTrack {
+public:
+    RootMotionTrack();
+
+    // builds the track from the root position of every frame, in model space
+    void extract(const std::vector<Cartesian3>& rootPositions);
+
+    void clear();
+
+    // true when the root barely travels, i.e. the clip was authored in place
+    bool inPlace() const;
+
+    std::size_t frameCount() const;
+
+    // root position of every frame, summed back up from the deltas and starting at the origin
+    std::vector<Cartesian3> positions() const;
+
+    // interleaved dx, dy of the displacement from frame i to frame i + 1
+    // the last frame repeats the previous displacement instead of jumping back to the start
+    std::vector<float> deltas;
+
+private:
+    bool stationary;
+};
+
+// Samples the displacement of count characters at once
+// heading is given as the cosine and sine of each character's rotation about Z,
+// results are world-space horizontal displacements multiplied by scale
+void sampleRootMotion(std::size_t count,
+                      const RootMotionTrack* const* tracks,
+                      const int* frames,
+                      const float* headingCos,
+                      const float* headingSin,
+                      float scale,
+                      float* dx,
+                      float* dy);
+
+#endif
@@ -16,14 +16,20 @@
 #include <cmath>
 #include <algorithm>
 #include <array>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
 
-// three local variables with the hardcoded file names
+#include "ContentHash.h"
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+
+// the terrain and the state machine, which lists the clips
 const std::string terrainName = "assets/randomland.dem";
-const std::string motionBvhStand = "assets/stand.bvh";
-const std::string motionBvhRun = "assets/fast_run.bvh";
-const std::string motionBvhVeerLeft = "assets/veer_left.bvh";
-const std::string motionBvhVeerRight = "assets/veer_right.bvh";
+const std::string stateMachineName = "assets/locomotion.fsm";
 constexpr float cameraSpeed = 0.5;
+// how far above the ground the camera is kept
+constexpr float cameraClearance = 1.5f;
 
 const Homogeneous4 sunDirection(0.5, -0.5, 0.3, 1.0);
 constexpr std::array<float, 4> groundColour = {0.2, 0.5, 0.2, 1.0};
@@ -35,9 +41,6 @@ constexpr std::array<float, 4> blackColour = {0.0, 0.0, 0.0, 1.0};
 // Measured in units
 constexpr float terrainPadding = 16.0f;
 
-// Measured in units/frame
-constexpr float speedDelta = 1.0f;
-
 // Direction
 const Cartesian3 forward(0.0f, 1.0f, 0.0f);
 const Cartesian3 up(0.0f, 0.0f, 1.0f);
@@ -45,26 +48,59 @@ const Cartesian3 up(0.0f, 0.0f, 1.0f);
 // Scales the animation model
 constexpr float bvhScale = 0.1f;
 
-// Veering
-// Account for Quaternion factor
-constexpr float veerRotationTheta = 45.0f / 2.0f;
-constexpr unsigned int veerFrames = 33;
-Quaternion veerFrom;
-Quaternion veerTo;
+// Motion matching
+// Ticks between searches, and how many frames off the playing frame a match may be and still be ignored
+constexpr unsigned int matchInterval = 10;
+constexpr int matchTolerance = 4;
+
+// Crowd
+// Members start at one of crowdPhases phases, and poses are shared between frames crowdPhaseQuantum apart
+constexpr std::size_t crowdSize = 24;
+constexpr float crowdSpacing = 12.0f;
+constexpr int crowdPhases = 4;
+constexpr int crowdPhaseQuantum = 2;
+// samples per second of the pose atlas used by distant members
+constexpr float crowdAtlasRate = 30.0f;
 
 // constructor
-Scene::Scene() {
-    // load the terrain
-    terrain.readTerrainFile(terrainName.data(), 3);
-    const float terrainRangeX = terrain.heightValues.size() * terrain.xyScale;
-    const float terrainRangeY = terrain.heightValues[0].size() * terrain.xyScale / 4;
-    terrainRange = std::make_pair(terrainRangeX - terrainPadding, terrainRangeY - terrainPadding);
-
-    // load the animation data
-    restPose.readBVHFile(motionBvhStand.data());
-    runCycle.readBVHFile(motionBvhRun.data());
-    veerLeftCycle.readBVHFile(motionBvhVeerLeft.data());
-    veerRightCycle.readBVHFile(motionBvhVeerRight.data());
+Scene::Scene()
+    : terrainLoaded(false),
+      terrainRead(false),
+      terrainReady(false),
+      terrainResolved(false),
+      clipsResolved(false),
+      currentAnimation(nullptr),
+      clipStartFrame(0),
+      crowd(crowdPhaseQuantum),
+      crowdVisible(false),
+      motionMatching(false),
+      ticksSinceMatch(0) {
+    // load the terrain in the background, the character stays unbounded at height 0 until then, or for good if
+    // it cannot be read
+    const float unbounded = std::numeric_limits<float>::max();
+    terrainRange = std::make_pair(unbounded, unbounded);
+    terrainLoading = std::async(std::launch::async, [this]() {
+        terrainRead = terrain.readTerrainFile(terrainName.data(), 3, &assets.workers());
+        if (!terrainRead) {
+            // a file that ends early leaves heights without normals or a pyramid
+            terrain = Terrain();
+        }
+        terrainLoaded.store(true, std::memory_order_release);
+    });
+
+    // states, transitions and the clips they play
+    if (!stateMachine.readFile(stateMachineName.data())) {
+        throw std::string(stateMachineName + ": " + stateMachine.error());
+    }
+    characters.resize(1);
+
+    // stream the animation data, the initial state's clip first since every state falls back on it
+    clips.resize(stateMachine.clipCount());
+    const int restClip = stateMachine.state(stateMachine.initialState()).clip;
+    clips[restClip] = assets.request(stateMachine.clipFile(restClip), stateMachine.clipView(restClip));
+    for (size_t clip = 0; clip < clips.size(); clip++) {
+        clips[clip] = assets.request(stateMachine.clipFile(clip), stateMachine.clipView(clip));
+    }
 
     // set initial camera
     world2OpenGLMatrix = Matrix4::rotationX(90.0);
@@ -72,50 +108,83 @@ Scene::Scene() {
     cameraRotation = Matrix4::rotationX(-30.0) * Matrix4::rotationZ(15.0);
 
     // initialize the character's position and rotation
-    eventCharacterReset();
+    resetCharacter();
+
+    // render has a camera before the first update
+    publishSnapshot();
 }
 
 void Scene::update() {
-    // increment the frame counter
+    // input received since the last tick
+    SceneEvent event;
+    while (events.pop(event)) {
+        handleEvent(event);
+    }
+
+    refreshLoadedAssets();
+
+    // increment the frame counter, a transition in progress decays along with it
     frameNumber++;
+    inertialization.advance();
 
-    // After blending finishes, discard data
-    // Restart frameNumber to smoothly transition between blendingAnimation -> currentAnimation
-    if (blendAnimation != nullptr && frameNumber >= blendAnimation->frameCount) {
-        frameNumber = 0;
-        delete blendAnimation;
-        blendAnimation = nullptr;
+    // events raised since the last tick and finished states are handled here
+    stateMachine.step(characters);
+    if (characters.fired[0] >= 0) {
+        enterState(stateMachine.transition(characters.fired[0]));
     }
 
-    if (state == AnimationState::VeeringLeft || state == AnimationState::VeeringRight) {
-        if (frameNumber < veerFrames) {
-            // Character is veering, slerp rotation
-            const float t = frameNumber / static_cast<float>(veerFrames);
-            characterRotation = slerp(veerFrom, veerTo, t);
-        } else {
-            // Blend into run or rest, depending on the preserved speed
-            state = characterSpeed > 0.0f ? AnimationState::Running : AnimationState::Resting;
-            BVH& nextAnimation = state == AnimationState::Running ? runCycle : restPose;
-            blendAnimation = currentAnimation->blend(frameNumber, nextAnimation);
-            frameNumber = 0;
-            currentAnimation = &nextAnimation;
-        }
+    // turning states slerp the rotation over their duration
+    const StateDefinition& state = stateMachine.state(characters.states[0]);
+    if (state.turn != 0.0f) {
+        const float t = characters.stateFrames[0] / static_cast<float>(state.duration);
+        characterRotation = slerp(turnFrom, turnTo, t);
+    }
+
+    if (motionMatching) {
+        matchMotion();
     }
 
     // move character along the terrain plane, respecting bounds
-    const Cartesian3 translation = characterSpeed * (characterRotation.matrix() * forward);
+    // clips that travel drive the character with their root motion,
+    // clips authored in place move it at the state's speed
+    const Cartesian3 heading = characterRotation.matrix() * forward;
+    Cartesian3 translation = characters.speeds[0] * heading;
+    if (currentAnimation != nullptr && !currentAnimation->rootMotion().inPlace()) {
+        const RootMotionTrack* track = &currentAnimation->rootMotion();
+        const int frame = clipFrame();
+        // heading is the character's rotation about Z applied to (0, 1, 0)
+        const float headingCos = heading.y;
+        const float headingSin = -heading.x;
+        sampleRootMotion(1, &track, &frame, &headingCos, &headingSin, bvhScale, &translation.x, &translation.y);
+        translation.z = 0.0f;
+    }
     Cartesian3 updatedXY = characterLocation + translation;
     updatedXY.x = std::clamp(updatedXY.x, -terrainRange.first, terrainRange.first);
     updatedXY.y = std::clamp(updatedXY.y, -terrainRange.second, terrainRange.second);
 
     // place character on top of the terrain
-    const float updatedZ = terrain.getHeight(updatedXY.x, updatedXY.y);
+    const float updatedZ = terrainReady ? terrain.getHeight(updatedXY.x, updatedXY.y) : 0.0f;
 
     // update character location with new coordinates
     characterLocation = Cartesian3(updatedXY.x, updatedXY.y, updatedZ);
+
+    // far away characters drop joints and update less often
+    characterLod = lodPolicy.select((characterLocation - cameraPosition()).length());
+    evaluateCharacterPose();
+
+    if (crowdVisible) {
+        crowd.update(terrainReady ? &terrain : nullptr, cameraPosition(), bvhScale);
+    }
+
+    publishSnapshot();
+
+    // transient tick data is discarded at the end of the tick
+    FrameArena::local().reset();
 }
 
 void Scene::render() {
+    MemoryScope memoryScope(MemorySubsystem::Rendering);
+
     // enable Z-buffering
     glEnable(GL_DEPTH_TEST);
 
@@ -134,11 +203,12 @@ void Scene::render() {
     // clear the buffer
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // compute the view matrix by combining camera translation, rotation & world2OpenGL
-    viewMatrix = world2OpenGLMatrix * cameraRotation * cameraTranslation;
+    // everything below is drawn from the latest tick, update may already be simulating the next one
+    const SceneSnapshot& frame = snapshots.acquire();
+    const Matrix4& viewMatrix = frame.viewMatrix;
 
     // compute the light position
-    Homogeneous4 lightDirection = world2OpenGLMatrix * cameraRotation * sunDirection;
+    Homogeneous4 lightDirection = frame.cameraMatrix * sunDirection;
 
     // turn it into Cartesian and normalise
     const Cartesian3 lightVector = lightDirection.Vector().unit();
@@ -154,120 +224,485 @@ void Scene::render() {
     glMaterialfv(GL_FRONT, GL_SPECULAR, blackColour.data());
     glMaterialfv(GL_FRONT, GL_EMISSION, blackColour.data());
 
-    // render the terrain
-    terrain.render(viewMatrix);
+    // render the terrain, shaded smoothly across its grid normals
+    if (frame.terrainReady) {
+        glShadeModel(GL_SMOOTH);
+        terrain.render(viewMatrix);
+        glShadeModel(GL_FLAT);
+    }
 
     // now set the colour to draw the bones
     glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, boneColour.data());
 
     // render the character
-    Matrix4 frameViewMatrix = viewMatrix * Matrix4::translation(characterLocation) * characterRotation.matrix();
-    // Not the solution we deserve, but the one we need
-    if (blendAnimation != nullptr) {
-        blendAnimation->render(frameViewMatrix, bvhScale, frameNumber);
-    } else {
-        currentAnimation->render(frameViewMatrix, bvhScale, frameNumber);
+    if (frame.characterSkeleton != nullptr) {
+        BVH::renderPose(*frame.characterSkeleton, viewMatrix * frame.characterMatrix, bvhScale,
+                        frame.characterPose.data(), frame.characterMask);
     }
+
+    if (frame.crowdVisible) {
+        frame.crowd.render(viewMatrix, bvhScale);
+    }
+
+    FrameArena::local().reset();
 }
 
 void Scene::eventCameraForward() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(0.0f, -cameraSpeed, 0.0f)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraForward);
 }
 
 void Scene::eventCameraBackward() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(0.0f, cameraSpeed, 0.0f)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraBackward);
 }
 
 void Scene::eventCameraLeft() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(cameraSpeed, 0.0f, 0.0f)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraLeft);
 }
 
 void Scene::eventCameraRight() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(-cameraSpeed, 0.0f, 0.0f)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraRight);
 }
 
 // camera control events: RF for vertical motion
 void Scene::eventCameraUp() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(0.0f, 0.0f, -cameraSpeed)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraUp);
 }
 
 void Scene::eventCameraDown() {
-    cameraTranslation = cameraTranslation *
-                        cameraRotation.transpose() *
-                        Matrix4::translation(Cartesian3(0.0f, 0.0f, cameraSpeed)) *
-                        cameraRotation;
+    queueEvent(SceneEvent::CameraDown);
 }
 
 void Scene::eventCameraTurnLeft() {
-    cameraRotation = cameraRotation * Matrix4::rotationZ(2.0f);
+    queueEvent(SceneEvent::CameraTurnLeft);
 }
 
 void Scene::eventCameraTurnRight() {
-    cameraRotation = cameraRotation * Matrix4::rotationZ(-2.0f);
+    queueEvent(SceneEvent::CameraTurnRight);
 }
 
 void Scene::eventCharacterTurnLeft() {
-    if (state == AnimationState::VeeringLeft) return;
-
-    state = AnimationState::VeeringLeft;
-    blendAnimation = currentAnimation->blend(frameNumber, veerLeftCycle);
-    frameNumber = 0;
-    veerFrom = characterRotation;
-    veerTo = characterRotation * Quaternion(up, veerRotationTheta);
-    currentAnimation = &veerLeftCycle;
+    queueEvent(SceneEvent::CharacterTurnLeft);
 }
 
 void Scene::eventCharacterTurnRight() {
-    if (state == AnimationState::VeeringRight) return;
-
-    state = AnimationState::VeeringRight;
-    blendAnimation = currentAnimation->blend(frameNumber, veerRightCycle);
-    frameNumber = 0;
-    veerFrom = characterRotation;
-    veerTo = characterRotation * Quaternion(up, -veerRotationTheta);
-    currentAnimation = &veerRightCycle;
+    queueEvent(SceneEvent::CharacterTurnRight);
 }
 
 void Scene::eventCharacterForward() {
-    if (state == AnimationState::Running) return;
-
-    state = AnimationState::Running;
-    blendAnimation = currentAnimation->blend(frameNumber, runCycle);
-    frameNumber = 0;
-    characterSpeed = speedDelta;
-    currentAnimation = &runCycle;
+    queueEvent(SceneEvent::CharacterForward);
 }
 
 void Scene::eventCharacterBackward() {
-    if (state == AnimationState::Resting) return;
+    queueEvent(SceneEvent::CharacterBackward);
+}
+
+void Scene::eventCharacterReset() {
+    queueEvent(SceneEvent::CharacterReset);
+}
+
+void Scene::eventToggleCrowd() {
+    queueEvent(SceneEvent::ToggleCrowd);
+}
+
+void Scene::eventToggleMotionMatching() {
+    queueEvent(SceneEvent::ToggleMotionMatching);
+}
+
+void Scene::eventReport() {
+    queueEvent(SceneEvent::Report);
+}
+
+void Scene::queueEvent(const SceneEvent event) {
+    // the queue only fills when update stalls, the event is lost then
+    if (!events.push(event)) {
+        droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Scene::handleEvent(const SceneEvent event) {
+    switch (event) {
+        case SceneEvent::CameraForward:
+            moveCamera(Cartesian3(0.0f, -cameraSpeed, 0.0f));
+            break;
+        case SceneEvent::CameraBackward:
+            moveCamera(Cartesian3(0.0f, cameraSpeed, 0.0f));
+            break;
+        case SceneEvent::CameraLeft:
+            moveCamera(Cartesian3(cameraSpeed, 0.0f, 0.0f));
+            break;
+        case SceneEvent::CameraRight:
+            moveCamera(Cartesian3(-cameraSpeed, 0.0f, 0.0f));
+            break;
+        case SceneEvent::CameraUp:
+            moveCamera(Cartesian3(0.0f, 0.0f, -cameraSpeed));
+            break;
+        case SceneEvent::CameraDown:
+            moveCamera(Cartesian3(0.0f, 0.0f, cameraSpeed));
+            break;
+        case SceneEvent::CameraTurnLeft:
+            cameraRotation = cameraRotation * Matrix4::rotationZ(2.0f);
+            break;
+        case SceneEvent::CameraTurnRight:
+            cameraRotation = cameraRotation * Matrix4::rotationZ(-2.0f);
+            break;
+        case SceneEvent::CharacterTurnLeft:
+            characters.triggers[0] = static_cast<int>(StateTrigger::Left);
+            break;
+        case SceneEvent::CharacterTurnRight:
+            characters.triggers[0] = static_cast<int>(StateTrigger::Right);
+            break;
+        case SceneEvent::CharacterForward:
+            characters.triggers[0] = static_cast<int>(StateTrigger::Forward);
+            break;
+        case SceneEvent::CharacterBackward:
+            characters.triggers[0] = static_cast<int>(StateTrigger::Backward);
+            break;
+        case SceneEvent::CharacterReset:
+            resetCharacter();
+            break;
+        case SceneEvent::ToggleMotionMatching:
+            toggleMotionMatching();
+            break;
+        case SceneEvent::ToggleCrowd:
+            crowdVisible = !crowdVisible;
+            break;
+        case SceneEvent::Report:
+            MemoryTracker::report(std::cout);
+            report(std::cout);
+            break;
+    }
+}
+
+void Scene::moveCamera(const Cartesian3& offset) {
+    const Cartesian3 from = cameraPosition();
+    cameraTranslation = cameraTranslation *
+                        cameraRotation.transpose() *
+                        Matrix4::translation(offset) *
+                        cameraRotation;
+    if (!terrainReady) {
+        return;
+    }
+
+    // stop where the move would pass into the ground, then keep clear of it
+    Cartesian3 position = cameraPosition();
+    float distance;
+    if (terrain.castRay(from, position - from, 1.0f, distance)) {
+        position = from + distance * (position - from);
+    }
+    position.z = std::max(position.z, terrain.getHeight(position.x, position.y) + cameraClearance);
+    cameraTranslation = Matrix4::translation(-position);
+}
+
+void Scene::enterState(const StateTransition& transition) {
+    const StateDefinition& state = stateMachine.state(transition.target);
+
+    // Account for Quaternion factor
+    turnFrom = characterRotation;
+    turnTo = characterRotation * Quaternion(up, state.turn / 2.0f);
+
+    playClip(clips[state.clip], transition.blendFrames);
+}
+
+void Scene::startTransition(const BVH& nextAnimation, const int startFrame, const int blendFrames) {
+    // nothing to transition from before the first clip has loaded
+    if (currentAnimation != nullptr) {
+        inertialization.start(*currentAnimation, clipFrame(), nextAnimation, startFrame, blendFrames);
+    }
 
-    state = AnimationState::Resting;
-    blendAnimation = currentAnimation->blend(frameNumber, restPose);
     frameNumber = 0;
-    characterSpeed = 0.0f;
-    currentAnimation = &restPose;
+    currentAnimation = &nextAnimation;
+    clipStartFrame = startFrame;
 }
 
-void Scene::eventCharacterReset() {
+void Scene::evaluateCharacterPose() {
+    const BVH* animation = currentAnimation;
+    if (animation == nullptr) {
+        return;
+    }
+
+    // only the clip being played is evaluated, a transition adds its decaying offsets on top
+    characterPose.evaluate(*animation, clipFrame(), bvhScale, characterLod, inertialization.offsets());
+
+    // the evaluated pose is cached across ticks, foot IK works on a copy
+    groundedPose = characterPose.jointMatrices();
+    if (terrainReady) {
+        const Cartesian3 heading = characterRotation.matrix() * forward;
+        GroundedCharacter character{animation->skeleton.get(), groundedPose.data(), characterPose.mask(),
+                                    characterLocation, heading.y, -heading.x};
+        footIk.apply(terrain, 1, &character);
+    }
+}
+
+void Scene::publishSnapshot() {
+    SceneSnapshot& frame = snapshots.back();
+
+    // compute the view matrix by combining camera translation, rotation & world2OpenGL
+    frame.cameraMatrix = world2OpenGLMatrix * cameraRotation;
+    frame.viewMatrix = frame.cameraMatrix * cameraTranslation;
+    frame.terrainReady = terrainReady;
+
+    frame.characterSkeleton =
+            currentAnimation != nullptr && !groundedPose.empty() ? currentAnimation->skeleton.get() : nullptr;
+    frame.characterMatrix = Affine3x4::translation(characterLocation) * Affine3x4(characterRotation.matrix());
+    frame.characterPose = groundedPose;
+    frame.characterMask = characterPose.mask();
+
+    frame.crowdVisible = crowdVisible;
+    if (crowdVisible) {
+        crowd.snapshot(frame.crowd);
+    }
+
+    snapshots.publish();
+}
+
+Cartesian3 Scene::cameraPosition() const {
+    // cameraTranslation is a pure translation by the negated camera position
+    return Cartesian3(-cameraTranslation[0][3], -cameraTranslation[1][3], -cameraTranslation[2][3]);
+}
+
+const ClipHandle& Scene::restPose() const {
+    return clips[stateMachine.state(stateMachine.initialState()).clip];
+}
+
+int Scene::clipFrame() const {
+    return frameNumber + clipStartFrame;
+}
+
+int Scene::transitionFrame(const BVH& nextAnimation) const {
+    return currentAnimation == nullptr ? 0 : transitions.bestFrame(*currentAnimation, clipFrame(), nextAnimation);
+}
+
+std::vector<const BVH*> Scene::loopingClips() const {
+    std::vector<const BVH*> looping;
+    for (size_t state = 0; state < stateMachine.stateCount(); state++) {
+        const BVH* clip = clips[stateMachine.state(state).clip].get();
+        if (clip != nullptr && stateMachine.state(state).duration == 0 &&
+            std::find(looping.begin(), looping.end(), clip) == looping.end()) {
+            looping.push_back(clip);
+        }
+    }
+    return looping;
+}
+
+void Scene::bakeCrowdAtlas() {
+    // keyed by the contents of the baked clips and the bake settings
+    const std::vector<const BVH*> baked = loopingClips();
+    if (baked.empty()) {
+        return;
+    }
+    std::uint64_t key = contentHash(&crowdAtlasRate, sizeof(crowdAtlasRate));
+    key = contentHash(&bvhScale, sizeof(bvhScale), key);
+    for (const BVH* clip : baked) {
+        for (const ClipHandle& handle : clips) {
+            if (handle.get() == clip) {
+                const std::uint64_t clipHash = handle.hash();
+                key = contentHash(&clipHash, sizeof(clipHash), key);
+            }
+        }
+    }
+
+    const std::string cached = assets.cachePath(key, "atlas");
+    if (!cached.empty() && crowdAtlas.readFile(cached.data(), key)) {
+        return;
+    }
+    crowdAtlas.bake(baked, crowdAtlasRate, bvhScale);
+    if (!cached.empty()) {
+        // written under a unique name and renamed, like cached clips, so a partial atlas is never read back
+        const std::string temporary = cached + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (crowdAtlas.writeFile(temporary.data(), key)) {
+            std::error_code error;
+            std::filesystem::rename(temporary, cached, error);
+        }
+        std::remove(temporary.data());
+    }
+}
+
+void Scene::buildTransitionTable() {
+    // clips of states with a duration are timed against it, they always start from their first frame
+    std::vector<const BVH*> sources;
+    for (const ClipHandle& clip : clips) {
+        if (clip.get() != nullptr) {
+            sources.push_back(clip.get());
+        }
+    }
+    transitions.build(sources, loopingClips());
+}
+
+void Scene::buildMotionDatabase() {
+    // clips authored in place travel at the speed of the fastest state playing them
+    bool added = false;
+    for (size_t clip = 0; clip < clips.size(); clip++) {
+        if (clips[clip].get() == nullptr) {
+            continue;
+        }
+        float speed = 0.0f;
+        for (size_t state = 0; state < stateMachine.stateCount(); state++) {
+            if (stateMachine.state(state).clip == static_cast<int>(clip)) {
+                speed = std::max(speed, stateMachine.state(state).speed);
+            }
+        }
+        motionDatabase.addClip(*clips[clip].get(), speed / bvhScale);
+        added = true;
+    }
+    if (added) {
+        motionDatabase.build();
+    }
+}
+
+void Scene::matchMotion() {
+    // a new transition would cut the current one short
+    if (motionDatabase.empty() || currentAnimation == nullptr || inertialization.active()) {
+        return;
+    }
+    if (++ticksSinceMatch < matchInterval) {
+        return;
+    }
+    ticksSinceMatch = 0;
+
+    // wanted trajectory: keep the state's speed, turning for as long as the state does
+    const StateDefinition& state = stateMachine.state(characters.states[0]);
+    float turnRate = 0.0f;
+    if (state.turn != 0.0f && characters.stateFrames[0] < state.duration) {
+        turnRate = state.turn / state.duration;
+    }
+    const float speed = characters.speeds[0] / bvhScale;
+
+    std::array<Cartesian3, TRAJECTORY_SAMPLES> trajectory;
+    Cartesian3 position;
+    float heading = 0.0f;
+    for (int step = 0; step < TRAJECTORY_SAMPLES * TRAJECTORY_STEP; step++) {
+        heading += turnRate;
+        position = position + speed * Cartesian3(-std::sin(DEG2RAD(heading)), std::cos(DEG2RAD(heading)), 0.0f);
+        if ((step + 1) % TRAJECTORY_STEP == 0) {
+            trajectory[step / TRAJECTORY_STEP] = position;
+        }
+    }
+
+    const MotionMatch match = motionDatabase.search(motionDatabase.clipIndex(currentAnimation), clipFrame(),
+                                                    trajectory);
+    const BVH* matched = motionDatabase.clip(match.clip);
+
+    // the best continuation is where playback already is
+    const int playing = clipFrame() % currentAnimation->frameCount;
+    const int offset = std::abs(match.frame - playing);
+    if (matched == currentAnimation && std::min(offset, currentAnimation->frameCount - offset) <= matchTolerance) {
+        return;
+    }
+
+    startTransition(*matched, match.frame);
+}
+
+void Scene::playClip(const ClipHandle& clip, const int blendFrames) {
+    targetClip = &clip;
+
+    // motion matching picks the clips itself
+    if (motionMatching) {
+        return;
+    }
+
+    const BVH* nextAnimation = clip.get() != nullptr ? clip.get() : restPose().get();
+    if (nextAnimation != nullptr && nextAnimation != currentAnimation) {
+        startTransition(*nextAnimation, transitionFrame(*nextAnimation), blendFrames);
+    }
+}
+
+void Scene::refreshLoadedAssets() {
+    if (!terrainResolved && terrainLoaded.load(std::memory_order_acquire)) {
+        terrainResolved = true;
+        terrainReady = terrainRead;
+        if (terrainReady) {
+            const float terrainRangeX = terrain.heightValues.size() * terrain.xyScale;
+            const float terrainRangeY = terrain.heightValues[0].size() * terrain.xyScale / 4;
+            terrainRange = std::make_pair(terrainRangeX - terrainPadding, terrainRangeY - terrainPadding);
+        } else {
+            std::cerr << "Failed to load terrain " << terrainName << ", the ground stays flat at height 0"
+                      << std::endl;
+        }
+    }
+
+    // derived data covers the clips that loaded, the rest pose stands in for the others
+    const bool clipsReady = std::all_of(clips.begin(), clips.end(), [](const ClipHandle& clip) {
+        return clip.ready();
+    });
+    if (clipsReady && !clipsResolved) {
+        clipsResolved = true;
+        reportFailedClips(std::cerr);
+        buildTransitionTable();
+        buildMotionDatabase();
+        bakeCrowdAtlas();
+        crowd.populate(loopingClips(), crowdSize, crowdSpacing, crowdPhases);
+        crowd.setAtlas(&crowdAtlas);
+    }
+
+    // the wanted clip arrived while a stand-in was playing
+    const BVH* wanted = motionMatching ? currentAnimation : targetClip->get();
+    if (wanted == nullptr && currentAnimation == nullptr) {
+        wanted = restPose().get();
+    }
+    if (wanted != nullptr && wanted != currentAnimation) {
+        startTransition(*wanted, transitionFrame(*wanted));
+    }
+}
+
+void Scene::reportFailedClips(std::ostream& outStream) const {
+    for (size_t clip = 0; clip < clips.size(); clip++) {
+        if (clips[clip].failed()) {
+            outStream << "Failed to load animation clip " << stateMachine.clipName(clip) << " ("
+                      << clips[clip].name() << "): " << clips[clip].problem() << std::endl;
+        }
+    }
+    if (restPose().failed()) {
+        outStream << "No rest pose to stand in, states whose clip failed keep playing the previous clip." << std::endl;
+    }
+}
+
+void Scene::report(std::ostream& outStream) const {
+    const AssetStats stats = assets.stats();
+    outStream << "clips loaded: " << stats.clipsLoaded
+              << ", pending: " << stats.clipsPending
+              << ", cache hits: " << stats.cacheHits
+              << ", cache misses: " << stats.cacheMisses
+              << ", skeletons: " << stats.uniqueSkeletons << "\n";
+
+    for (const auto& latency : assets.loadLatencies()) {
+        outStream << "  " << latency.first << ": " << 1000.0 * latency.second << " ms\n";
+    }
+    outStream << "terrain " << (terrainReady ? "loaded" : terrainResolved ? "failed" : "loading") << "\n";
+    outStream << "character lod " << characterLod.level
+              << ", update interval " << characterLod.interval
+              << ", joints evaluated last tick " << characterPose.recomputedJoints()
+              << ", transition frames left " << std::max(0, inertialization.remainingFrames()) << "\n";
+    outStream << "transition table " << transitions.bytes() << " bytes\n";
+    outStream << "crowd " << (crowdVisible ? "shown" : "hidden") << ", " << crowd.size() << " members"
+              << ", poses evaluated last tick " << crowd.poseCache().poseCount()
+              << ", pose cache hit rate " << 100.0f * crowd.poseCache().tickHitRate() << "% last tick, "
+              << 100.0f * crowd.poseCache().hitRate() << "% overall"
+              << ", posed from the atlas " << crowd.atlasMembers() << "\n";
+    outStream << "crowd atlas " << crowdAtlas.clipCount() << " clips, " << crowdAtlas.sampleCount() << " samples x "
+              << crowdAtlas.jointCount() << " joints, " << crowdAtlas.bytes() << " bytes\n";
+    outStream << "input events dropped " << droppedEvents.load(std::memory_order_relaxed) << "\n";
+    outStream << "motion matching " << (motionMatching ? "on" : "off")
+              << ", database frames " << motionDatabase.size()
+              << ", frames compared by last search " << motionDatabase.lastVisited() << std::endl;
+}
+
+void Scene::resetCharacter() {
     this->characterLocation = Cartesian3(0, 0, 0);
     this->characterRotation = Quaternion(up, 0.0f);
-    this->characterSpeed = 0.0f;
-    this->state = AnimationState::Resting;
-    this->currentAnimation = &restPose;
+    this->stateMachine.reset(characters, 0);
+    this->targetClip = &restPose();
+    this->currentAnimation = restPose().get();
+    this->clipStartFrame = 0;
     this->frameNumber = 0;
+    this->inertialization.cancel();
+}
+
+void Scene::toggleMotionMatching() {
+    motionMatching = !motionMatching;
+    ticksSinceMatch = 0;
+
+    // back to the clip of the current state
+    if (!motionMatching) {
+        playClip(*targetClip);
+    }
 }
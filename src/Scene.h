@@ -1,23 +1,75 @@
 #ifndef SCENE
 #define SCENE
 
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <memory>
+
 #include "Terrain.h"
+#include "Affine3x4.h"
+#include "AnimationLod.h"
+#include "AssetManager.h"
 #include "BVH.h"
+#include "Crowd.h"
+#include "PoseAtlas.h"
+#include "FootIk.h"
+#include "Inertialization.h"
 #include "Matrix4.h"
+#include "MotionDatabase.h"
 #include "Quaternion.h"
+#include "SpscQueue.h"
+#include "StateMachine.h"
+#include "TransitionTable.h"
+#include "TripleBuffer.h"
+
+// Input handled by the next update, in the order it was received
+enum class SceneEvent {
+    CameraForward, CameraBackward, CameraLeft, CameraRight, CameraUp, CameraDown, CameraTurnLeft, CameraTurnRight,
+    CharacterTurnLeft, CharacterTurnRight, CharacterForward, CharacterBackward, CharacterReset,
+    ToggleMotionMatching, ToggleCrowd, Report
+};
+
+// Everything render draws, written by update at the end of each tick
+// Pointers refer to data that stays immutable once loaded: skeletons, their masks and the crowd atlas
+struct SceneSnapshot {
+    // world2OpenGLMatrix * cameraRotation, lights are placed with it
+    Matrix4 cameraMatrix;
+    Matrix4 viewMatrix;
+    bool terrainReady = false;
+
+    // nullptr until the first clip is loaded
+    const Skeleton* characterSkeleton = nullptr;
+    Affine3x4 characterMatrix;
+    std::vector<Affine3x4> characterPose;
+    const unsigned char* characterMask = nullptr;
 
-enum class AnimationState {
-    Resting, Running, VeeringLeft, VeeringRight
+    bool crowdVisible = false;
+    CrowdSnapshot crowd;
 };
 
+// update and render may run on two different threads at the same time: update publishes a snapshot of
+// each tick and render draws the latest one, so the next tick is simulated while the last one is drawn
+// Events may be raised from the render thread, they are queued for the next update
 class Scene {
 public:
     Scene();
 
+    // simulates a tick and publishes it for render
+    // only one thread may call update
     void update();
 
+    // draws the latest tick published by update
+    // only one thread, the one owning the GL context, may call render and raise events
     void render();
 
+    // asset loading metrics: pending clips and per-clip load latency
+    // reads update-side state, use eventReport while update runs on another thread
+    void report(std::ostream& outStream) const;
+
+    // prints the memory and scene reports from the next update
+    void eventReport();
+
     /* Camera events */
     void eventCameraForward();
 
@@ -35,7 +87,7 @@ public:
 
     void eventCameraTurnRight();
 
-    /* Character events */
+    /* Character events, handled by the state machine on the next update */
     void eventCharacterTurnLeft();
 
     void eventCharacterTurnRight();
@@ -46,26 +98,134 @@ public:
 
     void eventCharacterReset();
 
+    // switch between state-driven transitions and motion matching
+    void eventToggleMotionMatching();
+
+    // show or hide the background crowd
+    void eventToggleCrowd();
+
 private:
-    Terrain terrain;
+    // hands an event to update, counting it as dropped when the queue is full
+    void queueEvent(SceneEvent event);
+
+    // applies an event raised since the last update
+    void handleEvent(SceneEvent event);
+
+    // moves the camera by offset in view space, stopping above the terrain once it has loaded
+    void moveCamera(const Cartesian3& offset);
+
+    // character back at the origin in the initial state
+    void resetCharacter();
+
+    void toggleMotionMatching();
+
+    // copies what render needs into the next snapshot and hands it over
+    void publishSnapshot();
+
+    // play nextAnimation from startFrame, inertializing away the jump from the current frame of currentAnimation
+    void startTransition(const BVH& nextAnimation, int startFrame = 0, int blendFrames = DEFAULT_BLEND_FRAMES);
+
+    // plays the clip of the transition's target and starts its turn
+    void enterState(const StateTransition& transition);
 
-    BVH restPose;
-    BVH runCycle;
-    BVH veerLeftCycle;
-    BVH veerRightCycle;
+    // clip of the initial state, it stands in for clips that are still loading
+    const ClipHandle& restPose() const;
 
-    BVH* currentAnimation;
-    // nullptr when not blending
-    BVH* blendAnimation;
+    // frame of currentAnimation that is playing
+    int clipFrame() const;
+
+    // frame of nextAnimation whose pose is closest to the one playing
+    int transitionFrame(const BVH& nextAnimation) const;
+
+    // switch to clip, standing in with the rest pose while it is still loading
+    void playClip(const ClipHandle& clip, int blendFrames = DEFAULT_BLEND_FRAMES);
+
+    // pick up clips and terrain that finished loading since the last tick
+    void refreshLoadedAssets();
+
+    // prints every clip that failed to load and why, the rest pose stands in for them when it loaded
+    void reportFailedClips(std::ostream& outStream) const;
+
+    // features of every loaded clip, built once all of them finished loading
+    void buildMotionDatabase();
+
+    // loaded clips of states that loop until a transition, each listed once
+    std::vector<const BVH*> loopingClips() const;
+
+    // closest frames between the loaded looping clips, built once all clips finished loading
+    void buildTransitionTable();
+
+    // the crowd's clips baked for distant members, read from the disk cache when unchanged
+    void bakeCrowdAtlas();
+
+    // periodically transitions into the frame that best continues the pose along the wanted trajectory
+    void matchMotion();
+
+    // brings characterPose up to date with the playing animation and grounds its feet
+    void evaluateCharacterPose();
+
+    // world-space camera location, recovered from cameraTranslation
+    Cartesian3 cameraPosition() const;
+
+    // its workers also compute the terrain's normals
+    AssetManager assets;
+
+    Terrain terrain;
+    // set by the loading thread, terrain and terrainRead must not be touched before
+    std::atomic<bool> terrainLoaded;
+    // whether the file was read, the terrain is left empty when it was not
+    bool terrainRead;
+    // update-side view of terrainLoaded, only once the terrain was read
+    bool terrainReady;
+    // set once a finished load was handled, whether or not it succeeded
+    bool terrainResolved;
+    // declared after terrain and assets so that it is waited for before either is destroyed
+    std::future<void> terrainLoading;
+
+    // clips stream in the background, the scene runs before they are available
+    // indexed by the state machine's clip ids
+    std::vector<ClipHandle> clips;
+    // set once every clip finished loading and the data derived from them was built
+    bool clipsResolved;
+
+    StateMachine stateMachine;
+    // the character's state, speed and pending trigger
+    StateMachineBatch characters;
+    // rotation at the start and end of a turning state
+    Quaternion turnFrom;
+    Quaternion turnTo;
+
+    // clip the current state wants to play
+    const ClipHandle* targetClip;
+    // nullptr until the first clip is loaded
+    const BVH* currentAnimation;
+    // frame of currentAnimation playback started at
+    int clipStartFrame;
+    // what is left of the jump between the last two clips
+    Inertialization inertialization;
+    // model-space joint transforms, only recomputed where the pose changed
+    // and at a detail picked from the distance to the camera
+    LodPose characterPose;
+    LodPolicy lodPolicy;
+    LodSelection characterLod;
+    // characterPose with the legs fitted to the terrain, this is what is drawn
+    std::vector<Affine3x4> groundedPose;
+    FootIk footIk;
+
+    TransitionTable transitions;
+    // background characters looping the looping clips, sharing their poses
+    Crowd crowd;
+    bool crowdVisible;
+    PoseAtlas crowdAtlas;
+    MotionDatabase motionDatabase;
+    bool motionMatching;
+    unsigned long ticksSinceMatch;
 
-    AnimationState state;
     Cartesian3 characterLocation;
     Quaternion characterRotation;
-    float characterSpeed;
 
     Matrix4 world2OpenGLMatrix;
 
-    Matrix4 viewMatrix;
     Matrix4 cameraTranslation;
     Matrix4 cameraRotation;
 
@@ -73,6 +233,13 @@ private:
 
     // Defines [-x_r..x_r] and [-y_r..y_r] horizontal ranges in which the player can move
     std::pair<float, float> terrainRange;
+
+    // written by the render thread, drained by update
+    SpscQueue<SceneEvent, 64> events;
+    // events the full queue turned away, written by the render thread
+    std::atomic<std::size_t> droppedEvents{0};
+    // handed from update to render
+    TripleBuffer<SceneSnapshot> snapshots;
 };
 
 #endif
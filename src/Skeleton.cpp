@@ -0,0 +1,312 @@
+#include "Skeleton.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "BinaryIO.h"
+#include "ContentHash.h"
+
+Skeleton::Skeleton(): root(), frameChannels(0), mirrorAxis(0), hash(0) {
+}
+
+void Skeleton::finalise() {
+    // pointers into root are only held while flattening
+    std::vector<const Joint*> allJoints;
+    collectJoints(root, allJoints);
+
+    boneTranslations.clear();
+    jointChannels.clear();
+    channelLayouts.clear();
+    frameChannels = 0;
+    hash = contentHashSeed;
+    for (size_t joint = 0; joint < allJoints.size(); joint++) {
+        const Joint* current = allJoints[joint];
+        boneTranslations.emplace_back(current->offset[0], current->offset[1], current->offset[2]);
+        jointChannels.push_back(current->channels);
+        channelLayouts.push_back(compileChannelLayout(current->channels, frameChannels));
+        frameChannels += current->channels.size();
+
+        hash = contentHash(current->name, hash);
+        hash = contentHash(&parentBones[joint], sizeof(int), hash);
+        hash = contentHash(current->offset.data(), sizeof(current->offset), hash);
+        for (const auto& channel : current->channels) {
+            hash = contentHash(channel, hash);
+        }
+    }
+
+    // walking back, a joint's subtree ends where the subtree of its last child does
+    subtreeEnds.assign(allJoints.size(), 0);
+    for (int joint = allJoints.size() - 1; joint >= 0; joint--) {
+        subtreeEnds[joint] = std::max(subtreeEnds[joint], joint + 1);
+        if (parentBones[joint] >= 0) {
+            subtreeEnds[parentBones[joint]] = std::max(subtreeEnds[parentBones[joint]], subtreeEnds[joint]);
+        }
+    }
+
+    deriveLodMasks();
+    findLegs();
+    findMirrorJoints();
+}
+
+std::size_t Skeleton::jointCount() const {
+    return boneNames.size();
+}
+
+bool Skeleton::sameAs(const Skeleton& other) const {
+    if (hash != other.hash || boneNames != other.boneNames || parentBones != other.parentBones) {
+        return false;
+    }
+
+    for (size_t joint = 0; joint < jointCount(); joint++) {
+        const Cartesian3& offset = boneTranslations[joint];
+        const Cartesian3& otherOffset = other.boneTranslations[joint];
+        if (offset.x != otherOffset.x || offset.y != otherOffset.y || offset.z != otherOffset.z ||
+            jointChannels[joint] != other.jointChannels[joint]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Skeleton::validate(std::string& problem) const {
+    if (jointCount() == 0) {
+        problem = "no joints";
+        return false;
+    }
+
+    for (size_t joint = 0; joint < jointCount(); joint++) {
+        const std::string& name = boneNames[joint];
+        if (std::find(boneNames.begin(), boneNames.begin() + joint, name) != boneNames.begin() + joint) {
+            problem = "joint name " + name + " repeats";
+            return false;
+        }
+
+        bool seen[6] = {false, false, false, false, false, false};
+        for (const auto& channel : jointChannels[joint]) {
+            const int index = channelIndex(channel);
+            if (index < 0 || seen[index]) {
+                problem = "joint " + name + (index < 0 ? " has unknown channel " : " repeats channel ") + channel;
+                return false;
+            }
+            seen[index] = true;
+        }
+    }
+
+    if ((channelLayouts[0].flags & HAS_POSITION) == 0) {
+        problem = "root " + boneNames[0] + " has no position channels";
+        return false;
+    }
+    return true;
+}
+
+Skeleton Skeleton::bakedChannels() const {
+    static const std::vector<std::string> rotationChannels = {"Xrotation", "Yrotation", "Zrotation"};
+    static const std::vector<std::string> rootChannels = {"Xposition", "Yposition", "Zposition",
+                                                          "Xrotation", "Yrotation", "Zrotation"};
+
+    Skeleton baked;
+    baked.root = root;
+    baked.boneNames = boneNames;
+    baked.parentBones = parentBones;
+
+    // only the root's position is ever decoded, positions on other joints are dropped
+    const std::function<void(Joint&)> bakeJoint = [&](Joint& joint) {
+        const JointChannelLayout& layout = channelLayouts[joint.id];
+        if (joint.id == 0) {
+            joint.channels = rootChannels;
+        } else if (layout.flags & HAS_ROTATION) {
+            joint.channels = rotationChannels;
+        } else {
+            joint.channels.clear();
+        }
+        for (auto& child : joint.children) {
+            bakeJoint(child);
+        }
+    };
+    bakeJoint(baked.root);
+
+    baked.finalise();
+    return baked;
+}
+
+void Skeleton::write(std::ostream& outStream) const {
+    writeValue(outStream, static_cast<std::uint32_t>(jointCount()));
+
+    for (size_t joint = 0; joint < jointCount(); joint++) {
+        const Cartesian3& offset = boneTranslations[joint];
+        writeString(outStream, boneNames[joint]);
+        writeValue(outStream, static_cast<std::int32_t>(parentBones[joint]));
+        writeValue(outStream, std::array<float, 3>{offset.x, offset.y, offset.z});
+
+        writeValue(outStream, static_cast<std::uint32_t>(jointChannels[joint].size()));
+        for (const auto& channel : jointChannels[joint]) {
+            writeString(outStream, channel);
+        }
+    }
+}
+
+bool Skeleton::read(std::istream& inStream) {
+    std::uint32_t jointCount = 0;
+    if (!readValue(inStream, jointCount) || jointCount == 0) {
+        return false;
+    }
+
+    // read the flattened joints, then rebuild the tree from the parent ids
+    std::vector<Joint> joints(jointCount);
+    boneNames.resize(jointCount);
+    parentBones.resize(jointCount);
+    std::vector<std::vector<int>> childIds(jointCount);
+
+    for (std::uint32_t joint = 0; joint < jointCount; joint++) {
+        std::int32_t parent = -1;
+        std::uint32_t channelCount = 0;
+        joints[joint].id = joint;
+        if (!readString(inStream, joints[joint].name) ||
+            !readValue(inStream, parent) ||
+            !readValue(inStream, joints[joint].offset) ||
+            !readValue(inStream, channelCount)) {
+            return false;
+        }
+
+        // depth-first order guarantees parents come first
+        if ((joint == 0) != (parent < 0) || parent >= static_cast<std::int32_t>(joint)) {
+            return false;
+        }
+
+        joints[joint].channels.resize(channelCount);
+        for (auto& channel : joints[joint].channels) {
+            if (!readString(inStream, channel)) {
+                return false;
+            }
+        }
+
+        boneNames[joint] = joints[joint].name;
+        parentBones[joint] = parent;
+        if (parent >= 0) {
+            childIds[parent].push_back(joint);
+        }
+    }
+
+    const std::function<void(Joint&)> attachChildren = [&](Joint& joint) {
+        for (const int child : childIds[joint.id]) {
+            joint.children.push_back(joints[child]);
+            attachChildren(joint.children.back());
+        }
+    };
+
+    root = joints[0];
+    attachChildren(root);
+    finalise();
+    return true;
+}
+
+void Skeleton::deriveLodMasks() {
+    const size_t count = jointCount();
+
+    lodMasks[0].assign(count, 1);
+
+    // a joint survives only if its parent did, parents come first
+    lodMasks[1].assign(count, 0);
+    for (size_t joint = 0; joint < count; joint++) {
+        const int parent = parentBones[joint];
+        lodMasks[1][joint] = (parent < 0 || lodMasks[1][parent]) && !isDetailJoint(boneNames[joint]);
+    }
+
+    // drop joints with no surviving children at level 1: hands, feet, head
+    std::vector<unsigned char> hasChildren(count, 0);
+    for (size_t joint = 1; joint < count; joint++) {
+        if (lodMasks[1][joint]) {
+            hasChildren[parentBones[joint]] = 1;
+        }
+    }
+    lodMasks[2].assign(count, 0);
+    for (size_t joint = 0; joint < count; joint++) {
+        lodMasks[2][joint] = lodMasks[1][joint] && (joint == 0 || hasChildren[joint]);
+    }
+}
+
+void Skeleton::findLegs() {
+    legs.clear();
+
+    // mixamo and most other rigs name the thigh *UpLeg, followed by the shin and the foot
+    const std::string thigh = "UpLeg";
+    const int count = jointCount();
+    for (int joint = 0; joint < count; joint++) {
+        const std::string& name = boneNames[joint];
+        if (name.size() < thigh.size() || name.compare(name.size() - thigh.size(), thigh.size(), thigh) != 0) {
+            continue;
+        }
+
+        // depth-first ids make a joint's first child the next id
+        const int knee = joint + 1;
+        const int ankle = joint + 2;
+        if (ankle >= count || parentBones[knee] != joint || parentBones[ankle] != knee) {
+            continue;
+        }
+
+        legs.push_back(LegChain{joint, knee, ankle});
+    }
+}
+
+void Skeleton::findMirrorJoints() {
+    const int count = jointCount();
+    mirrorJoints.resize(count);
+    mirrorAxis = 0;
+
+    // a joint's counterpart has Left and Right swapped in its name
+    const std::string left = "Left";
+    const std::string right = "Right";
+    bool axisFound = false;
+    for (int joint = 0; joint < count; joint++) {
+        mirrorJoints[joint] = joint;
+
+        std::string counterpart = boneNames[joint];
+        const size_t leftAt = counterpart.find(left);
+        const size_t rightAt = counterpart.find(right);
+        if (leftAt != std::string::npos) {
+            counterpart.replace(leftAt, left.size(), right);
+        } else if (rightAt != std::string::npos) {
+            counterpart.replace(rightAt, right.size(), left);
+        } else {
+            continue;
+        }
+
+        const auto found = std::find(boneNames.begin(), boneNames.end(), counterpart);
+        if (found == boneNames.end()) {
+            continue;
+        }
+        mirrorJoints[joint] = found - boneNames.begin();
+
+        // the first pair shows which axis separates the sides, their offsets only differ in sign along it
+        if (!axisFound) {
+            const Cartesian3 apart = boneTranslations[joint] - boneTranslations[mirrorJoints[joint]];
+            for (int axis = 1; axis < 3; axis++) {
+                if (std::fabs(apart[axis]) > std::fabs(apart[mirrorAxis])) {
+                    mirrorAxis = axis;
+                }
+            }
+            axisFound = true;
+        }
+    }
+}
+
+bool Skeleton::isDetailJoint(const std::string& name) {
+    static const char* detailNames[] = {"Thumb", "Index", "Middle", "Ring", "Pinky", "Toe", "_End"};
+
+    for (const char* detail : detailNames) {
+        if (name.find(detail) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Skeleton::collectJoints(const Joint& joint, std::vector<const Joint*>& joints) {
+    joints.push_back(&joint);
+
+    for (const auto& child : joint.children) {
+        collectJoints(child, joints);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Cartesian3.h"
+#include "ChannelLayout.h"
+
+// animation levels of detail, 0 evaluates every joint
+constexpr int LOD_LEVELS = 3;
+
+class Joint {
+public:
+    // index of Joint
+    int id;
+    std::string name;
+    std::array<float, 3> offset{0.0f, 0.0f, 0.0f};
+    std::vector<std::string> channels;
+    std::vector<Joint> children;
+};
+
+// hip, knee and ankle of a leg
+struct LegChain {
+    int hip;
+    int knee;
+    int ankle;
+};
+
+// Joint hierarchy of a BVH file, shared by every clip recorded on it
+// The flattened arrays hold values only, so copies are independent and a finalised skeleton
+// can be read from any number of threads
+class Skeleton {
+public:
+    Joint root;
+
+    // flattened hierarchy, indexed by joint id
+    // ids are assigned depth-first, so parents always precede their children
+    std::vector<std::string> boneNames;
+    // id -> parent id
+    std::vector<int> parentBones;
+    // joint offsets from their parents
+    std::vector<Cartesian3> boneTranslations;
+    // channel names of each joint, in the order their values appear in a frame
+    std::vector<std::vector<std::string>> jointChannels;
+    // jointChannels compiled for decoding, and the number of values in a frame
+    std::vector<JointChannelLayout> channelLayouts;
+    std::size_t frameChannels;
+    // id -> one past its last descendant, descendants of a joint have contiguous ids
+    std::vector<int> subtreeEnds;
+
+    // per level of detail, 1 for joints that are evaluated and drawn
+    // level 1 drops fingers, toes and end sites, level 2 further drops the extremities left by level 1
+    std::array<std::vector<unsigned char>, LOD_LEVELS> lodMasks;
+
+    // legs found by joint name, empty when the naming is not recognised
+    std::vector<LegChain> legs;
+
+    // id -> the same joint on the other side (LeftArm and RightArm), joints without a counterpart map to themselves
+    std::vector<int> mirrorJoints;
+    // 0-2 for the X, Y or Z axis the two sides lie apart along, in BVH space
+    int mirrorAxis;
+
+    // hash of names, offsets, channels and topology
+    std::uint64_t hash;
+
+    Skeleton();
+
+    // builds boneTranslations, jointChannels, channelLayouts, derived joint data and hash
+    // once root, boneNames and parentBones are read
+    void finalise();
+
+    std::size_t jointCount() const;
+
+    // structural equality, used to confirm hash matches
+    bool sameAs(const Skeleton& other) const;
+
+    // false, with the first problem found, when joint names repeat, a channel name is unknown or repeated,
+    // or the root has no position channels
+    bool validate(std::string& problem) const;
+
+    // a copy whose joints with rotation channels have exactly Xrotation Yrotation Zrotation, preceded on the root by
+    // Xposition Yposition Zposition, so every frame decodes through the packed decoders without conversions
+    Skeleton bakedChannels() const;
+
+    // binary serialisation, flattened depth-first
+    void write(std::ostream& outStream) const;
+
+    bool read(std::istream& inStream);
+
+private:
+    static void collectJoints(const Joint& joint, std::vector<const Joint*>& joints);
+
+    void deriveLodMasks();
+
+    void findLegs();
+
+    void findMirrorJoints();
+
+    static bool isDetailJoint(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread
+template<typename T, std::size_t N>
+class SpscQueue {
+public:
+    SpscQueue(): head(0), tail(0) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer side, false when the queue is full and value was dropped
+    bool push(const T& value) {
+        const std::size_t back = tail.load(std::memory_order_relaxed);
+        if (back - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        slots[back % N] = value;
+        tail.store(back + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, false when the queue is empty
+    bool pop(T& value) {
+        const std::size_t front = head.load(std::memory_order_relaxed);
+        if (front == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[front % N];
+        head.store(front + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, N> slots;
+    // counters only grow, their difference is the number of queued values
+    std::atomic<std::size_t> head;
+    std::atomic<std::size_t> tail;
+};
+
+#endif
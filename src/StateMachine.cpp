@@ -0,0 +1,307 @@
+#include "StateMachine.h"
+
+#include <array>
+#include <fstream>
+#include <sstream>
+
+constexpr int TRIGGER_COUNT = static_cast<int>(StateTrigger::Count);
+
+const std::array<const char*, TRIGGER_COUNT> triggerNames = {"forward", "backward", "left", "right", "done"};
+const std::array<const char*, static_cast<int>(StateParameter::Count)> parameterNames = {"speed"};
+const std::array<const char*, 6> opNames = {"<", "<=", ">", ">=", "==", "!="};
+
+void StateMachineBatch::resize(const std::size_t count) {
+    states.resize(count);
+    stateFrames.resize(count);
+    speeds.resize(count);
+    triggers.resize(count, -1);
+    fired.resize(count, -1);
+}
+
+std::size_t StateMachineBatch::size() const {
+    return states.size();
+}
+
+StateMachine::StateMachine() = default;
+
+bool StateMachine::readFile(const char* fileName) {
+    std::ifstream inFile(fileName);
+    if (!inFile.is_open()) {
+        errorMessage = std::string("cannot open ") + fileName;
+        return false;
+    }
+    return read(inFile);
+}
+
+bool StateMachine::read(std::istream& inStream) {
+    // names are resolved once everything is read, so definitions may come in any order
+    struct StateLine {
+        std::string clip;
+        StateDefinition definition;
+        int lineNumber;
+    };
+    struct TransitionLine {
+        std::string from;
+        std::string to;
+        int trigger;
+        StateTransition transition;
+        int lineNumber;
+    };
+
+    std::vector<std::string> stateNames;
+    std::vector<StateLine> stateLines;
+    std::vector<TransitionLine> transitionLines;
+    clipNames.clear();
+    clipFiles.clear();
+    clipViews.clear();
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(inStream, line); lineNumber++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword)) {
+            continue;
+        }
+
+        if (keyword == "clip") {
+            std::string name, file;
+            if (!(tokens >> name >> file)) {
+                return fail(lineNumber, "expected clip <name> <file>");
+            }
+
+            ClipView view;
+            std::string option;
+            while (tokens >> option) {
+                if (option == "from") {
+                    if (!(tokens >> view.firstFrame) || view.firstFrame < 0) {
+                        return fail(lineNumber, "expected from <first frame>");
+                    }
+                } else if (option == "frames") {
+                    if (!(tokens >> view.frameCount) || view.frameCount <= 0) {
+                        return fail(lineNumber, "expected frames <count>");
+                    }
+                } else if (option == "rate") {
+                    if (!(tokens >> view.rate) || view.rate <= 0.0f) {
+                        return fail(lineNumber, "expected rate <source frames per frame>");
+                    }
+                } else if (option == "pingpong") {
+                    view.loop = LoopMode::PingPong;
+                } else if (option == "mirror") {
+                    view.mirrored = true;
+                } else {
+                    return fail(lineNumber, "unexpected " + option);
+                }
+            }
+            clipNames.push_back(name);
+            clipFiles.push_back(file);
+            clipViews.push_back(view);
+        } else if (keyword == "state") {
+            std::string name, speed;
+            StateLine state{};
+            state.lineNumber = lineNumber;
+            if (!(tokens >> name >> state.clip >> speed >> state.definition.turn >> state.definition.duration)) {
+                return fail(lineNumber, "expected state <name> <clip> <speed | keep> <turn> <duration>");
+            }
+            state.definition.keepSpeed = speed == "keep";
+            if (!state.definition.keepSpeed) {
+                std::istringstream speedValue(speed);
+                if (!(speedValue >> state.definition.speed)) {
+                    return fail(lineNumber, "speed must be a number or keep");
+                }
+            }
+            if (state.definition.duration < 0 || (state.definition.turn != 0.0f && state.definition.duration == 0)) {
+                return fail(lineNumber, "turning states need a positive duration");
+            }
+            stateNames.push_back(name);
+            stateLines.push_back(state);
+        } else if (keyword == "transition") {
+            std::string trigger;
+            TransitionLine transition{};
+            transition.lineNumber = lineNumber;
+            transition.transition.blendFrames = DEFAULT_BLEND_FRAMES;
+            if (!(tokens >> transition.from >> transition.to >> trigger)) {
+                return fail(lineNumber, "expected transition <from | *> <to> <trigger>");
+            }
+            transition.trigger = findName({triggerNames.begin(), triggerNames.end()}, trigger);
+            if (transition.trigger < 0) {
+                return fail(lineNumber, "unknown trigger " + trigger);
+            }
+
+            std::string option;
+            while (tokens >> option) {
+                if (option == "when") {
+                    std::string parameter, op;
+                    if (!(tokens >> parameter >> op >> transition.transition.value)) {
+                        return fail(lineNumber, "expected when <parameter> <op> <value>");
+                    }
+                    const int parameterId = findName({parameterNames.begin(), parameterNames.end()}, parameter);
+                    const int opId = findName({opNames.begin(), opNames.end()}, op);
+                    if (parameterId < 0 || opId < 0) {
+                        return fail(lineNumber, "unknown condition " + parameter + " " + op);
+                    }
+                    transition.transition.parameter = static_cast<StateParameter>(parameterId);
+                    // ConditionOp::Always comes before the comparisons
+                    transition.transition.op = static_cast<ConditionOp>(opId + 1);
+                } else if (option == "blend") {
+                    if (!(tokens >> transition.transition.blendFrames) || transition.transition.blendFrames <= 0) {
+                        return fail(lineNumber, "expected blend <frames>");
+                    }
+                } else {
+                    return fail(lineNumber, "unexpected " + option);
+                }
+            }
+            transitionLines.push_back(transition);
+        } else {
+            return fail(lineNumber, "unknown keyword " + keyword);
+        }
+    }
+
+    if (stateLines.empty()) {
+        return fail(0, "no states");
+    }
+
+    states.clear();
+    for (StateLine& state : stateLines) {
+        state.definition.clip = findName(clipNames, state.clip);
+        if (state.definition.clip < 0) {
+            return fail(state.lineNumber, "unknown clip " + state.clip);
+        }
+        states.push_back(state.definition);
+    }
+
+    for (TransitionLine& transition : transitionLines) {
+        transition.transition.target = findName(stateNames, transition.to);
+        if (transition.transition.target < 0 || (transition.from != "*" && findName(stateNames, transition.from) < 0)) {
+            return fail(transition.lineNumber, "unknown state in transition");
+        }
+    }
+
+    // compile: the candidate transitions of every (state, trigger) pair laid out contiguously
+    transitions.clear();
+    transitionStarts.clear();
+    for (size_t state = 0; state < states.size(); state++) {
+        for (int trigger = 0; trigger < TRIGGER_COUNT; trigger++) {
+            transitionStarts.push_back(transitions.size());
+            for (const TransitionLine& transition : transitionLines) {
+                const bool fromState = transition.from == "*" ?
+                                       transition.transition.target != static_cast<int>(state) :
+                                       transition.from == stateNames[state];
+                if (fromState && transition.trigger == trigger) {
+                    transitions.push_back(transition.transition);
+                }
+            }
+        }
+    }
+    transitionStarts.push_back(transitions.size());
+
+    errorMessage.clear();
+    return true;
+}
+
+const std::string& StateMachine::error() const {
+    return errorMessage;
+}
+
+std::size_t StateMachine::clipCount() const {
+    return clipFiles.size();
+}
+
+const std::string& StateMachine::clipName(const int clip) const {
+    return clipNames[clip];
+}
+
+const std::string& StateMachine::clipFile(const int clip) const {
+    return clipFiles[clip];
+}
+
+const ClipView& StateMachine::clipView(const int clip) const {
+    return clipViews[clip];
+}
+
+std::size_t StateMachine::stateCount() const {
+    return states.size();
+}
+
+const StateDefinition& StateMachine::state(const int state) const {
+    return states[state];
+}
+
+const StateTransition& StateMachine::transition(const int transition) const {
+    return transitions[transition];
+}
+
+int StateMachine::initialState() const {
+    return 0;
+}
+
+void StateMachine::reset(StateMachineBatch& batch, const std::size_t character) const {
+    batch.states[character] = initialState();
+    batch.stateFrames[character] = 0;
+    batch.speeds[character] = states[initialState()].keepSpeed ? 0.0f : states[initialState()].speed;
+    batch.triggers[character] = -1;
+    batch.fired[character] = -1;
+}
+
+void StateMachine::step(StateMachineBatch& batch) const {
+    const std::size_t count = batch.size();
+    for (std::size_t character = 0; character < count; character++) {
+        const int state = batch.states[character];
+        const int frames = ++batch.stateFrames[character];
+        const int duration = states[state].duration;
+
+        int trigger = batch.triggers[character];
+        if (trigger < 0 && duration > 0 && frames >= duration) {
+            trigger = static_cast<int>(StateTrigger::Done);
+        }
+        batch.triggers[character] = -1;
+        batch.fired[character] = -1;
+        if (trigger < 0) {
+            continue;
+        }
+
+        // first candidate whose condition holds
+        const int pair = state * TRIGGER_COUNT + trigger;
+        for (int candidate = transitionStarts[pair]; candidate < transitionStarts[pair + 1]; candidate++) {
+            const StateTransition& transition = transitions[candidate];
+            // speed is the only parameter so far
+            const float value = batch.speeds[character];
+            bool holds = true;
+            switch (transition.op) {
+                case ConditionOp::Always: break;
+                case ConditionOp::Less: holds = value < transition.value; break;
+                case ConditionOp::LessEqual: holds = value <= transition.value; break;
+                case ConditionOp::Greater: holds = value > transition.value; break;
+                case ConditionOp::GreaterEqual: holds = value >= transition.value; break;
+                case ConditionOp::Equal: holds = value == transition.value; break;
+                case ConditionOp::NotEqual: holds = value != transition.value; break;
+            }
+            if (!holds) {
+                continue;
+            }
+
+            const StateDefinition& target = states[transition.target];
+            batch.states[character] = transition.target;
+            batch.stateFrames[character] = 0;
+            if (!target.keepSpeed) {
+                batch.speeds[character] = target.speed;
+            }
+            batch.fired[character] = candidate;
+            break;
+        }
+    }
+}
+
+bool StateMachine::fail(const int lineNumber, const std::string& message) {
+    errorMessage = "line " + std::to_string(lineNumber) + ": " + message;
+    return false;
+}
+
+int StateMachine::findName(const std::vector<std::string>& names, const std::string& name) {
+    for (size_t index = 0; index < names.size(); index++) {
+        if (names[index] == name) {
+            return index;
+        }
+    }
+    return -1;
+}
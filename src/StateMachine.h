@@ -0,0 +1,117 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+
+// Inputs a transition can wait for, Done is raised once a state's duration has elapsed
+enum class StateTrigger {
+    Forward, Backward, Left, Right, Done, Count
+};
+
+// Character values a transition condition can test
+enum class StateParameter {
+    Speed, Count
+};
+
+enum class ConditionOp {
+    Always, Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual
+};
+
+// State compiled from its definition, names resolved to ids
+struct StateDefinition {
+    int clip;
+    // true to carry the speed of the previous state over
+    bool keepSpeed;
+    // units per frame
+    float speed;
+    // degrees turned over the duration
+    float turn;
+    // frames, 0 loops until a transition is taken
+    int duration;
+};
+
+struct StateTransition {
+    int target;
+    StateParameter parameter;
+    ConditionOp op;
+    float value;
+    // frames the inertialized transition takes to close the gap between the two clips
+    int blendFrames;
+};
+
+// Characters run by a state machine, one entry per character in each field
+struct StateMachineBatch {
+    std::vector<int> states;
+    // ticks since the state was entered
+    std::vector<int> stateFrames;
+    std::vector<float> speeds;
+    // trigger raised since the last step, -1 for none
+    std::vector<int> triggers;
+    // transition taken by the last step, -1 for none
+    std::vector<int> fired;
+
+    void resize(std::size_t count);
+
+    std::size_t size() const;
+};
+
+// Animation state machine read from a .fsm file
+// Names only exist while reading, steps work on integer tables, so their cost does not depend on the graph size
+class StateMachine {
+public:
+    StateMachine();
+
+    // reads and compiles a .fsm file, see assets/locomotion.fsm for the format
+    bool readFile(const char* fileName);
+
+    bool read(std::istream& inStream);
+
+    // describes why the last read failed
+    const std::string& error() const;
+
+    std::size_t clipCount() const;
+
+    // name the file gives the clip
+    const std::string& clipName(int clip) const;
+
+    const std::string& clipFile(int clip) const;
+
+    // how the clip plays its file, the identity unless the clip line gave options
+    const ClipView& clipView(int clip) const;
+
+    std::size_t stateCount() const;
+
+    const StateDefinition& state(int state) const;
+
+    const StateTransition& transition(int transition) const;
+
+    int initialState() const;
+
+    // puts a character in the initial state
+    void reset(StateMachineBatch& batch, std::size_t character) const;
+
+    // advances every character by a tick, taking at most one transition each
+    void step(StateMachineBatch& batch) const;
+
+private:
+    bool fail(int lineNumber, const std::string& message);
+
+    static int findName(const std::vector<std::string>& names, const std::string& name);
+
+    std::vector<std::string> clipNames;
+    std::vector<std::string> clipFiles;
+    std::vector<ClipView> clipViews;
+    std::vector<StateDefinition> states;
+    std::vector<StateTransition> transitions;
+    // transitions of (state, trigger) are [starts[i], starts[i + 1]), i = state * trigger count + trigger
+    std::vector<int> transitionStarts;
+
+    std::string errorMessage;
+};
+
+#endif
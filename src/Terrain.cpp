@@ -1,13 +1,34 @@
 #include "Terrain.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <random>
+
+#include "BinaryIO.h"
+#include "MemoryTracker.h"
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+// identifies the binary terrain format and its revision
+constexpr std::uint32_t BINARY_TERRAIN_MAGIC = 0x4e525254; // "TRRN"
+constexpr std::uint32_t BINARY_TERRAIN_VERSION = 1;
 
 Terrain::Terrain(): xyScale(1) {
 }
 
-bool Terrain::readTerrainFile(const char* fileName, const float xyScale) {
+bool Terrain::readTerrainFile(const char* fileName, const float xyScale, ThreadPool* const pool) {
+    MemoryScope memoryScope(MemorySubsystem::Terrain);
+
     std::ifstream inFile(fileName);
-    if (inFile.bad()) {
+    if (!inFile) {
         return false;
     }
 
@@ -16,6 +37,10 @@ bool Terrain::readTerrainFile(const char* fileName, const float xyScale) {
 
     long height = 0, width = 0;
     inFile >> height >> width;
+    // the surface needs at least one square
+    if (!inFile || height < 2 || width < 2) {
+        return false;
+    }
 
     // Per row height values
     heightValues.resize(height);
@@ -27,56 +52,357 @@ bool Terrain::readTerrainFile(const char* fileName, const float xyScale) {
         }
     }
 
-    // We want the triangles to be centred at the origin,
-    // with the zero elevation set at 0 z, so we have to juggle things somewhat
-    // compute a temporary midpoint for the data so that it will end up centered at the origin
-    Cartesian3 midPoint{
-        midPoint.x = xyScale * (width / 2),
-        midPoint.y = xyScale * (height / 2),
-        midPoint.z = 0.0
+    // a truncated file
+    if (!inFile) {
+        return false;
+    }
+
+    buildSurface(pool);
+    return true;
+}
+
+bool Terrain::writeBinaryFile(const char* fileName) const {
+    std::ofstream outFile(fileName, std::ios::binary);
+    if (!outFile) {
+        return false;
+    }
+
+    writeValue(outFile, BINARY_TERRAIN_MAGIC);
+    writeValue(outFile, BINARY_TERRAIN_VERSION);
+    writeValue(outFile, xyScale);
+    writeValue(outFile, static_cast<std::uint32_t>(heightValues.size()));
+    for (const auto& row : heightValues) {
+        writeArray(outFile, row);
+    }
+
+    return static_cast<bool>(outFile);
+}
+
+bool Terrain::readBinaryFile(const char* fileName, ThreadPool* const pool) {
+    MemoryScope memoryScope(MemorySubsystem::Terrain);
+
+    std::ifstream inFile(fileName, std::ios::binary);
+    if (!inFile) {
+        return false;
+    }
+
+    std::uint32_t magic = 0, version = 0, rows = 0;
+    if (!readValue(inFile, magic) || magic != BINARY_TERRAIN_MAGIC ||
+        !readValue(inFile, version) || version != BINARY_TERRAIN_VERSION ||
+        !readValue(inFile, xyScale) || !readValue(inFile, rows) || rows < 2) {
+        return false;
+    }
+
+    heightValues.resize(rows);
+    for (auto& row : heightValues) {
+        if (!readArray(inFile, row) || row.size() != heightValues[0].size() || row.size() < 2) {
+            return false;
+        }
+    }
+
+    buildSurface(pool);
+    return true;
+}
+
+bool Terrain::generate(const long size, const float scale, const unsigned int seed, ThreadPool* const pool) {
+    MemoryScope memoryScope(MemorySubsystem::Terrain);
+
+    if (size < 2) {
+        return false;
+    }
+
+    // a few sine waves per octave, each octave half the wavelength and height of the last
+    constexpr int octaves = 6;
+    constexpr int wavesPerOctave = 3;
+    constexpr float baseWavelength = 256.0f;
+    constexpr float baseAmplitude = 40.0f;
+    constexpr float twoPi = 6.28318531f;
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    struct Wave {
+        float x, y, phase, amplitude;
+    };
+    std::vector<Wave> waves;
+    for (int octave = 0; octave < octaves; octave++) {
+        const float frequency = twoPi * float(1 << octave) / baseWavelength;
+        for (int wave = 0; wave < wavesPerOctave; wave++) {
+            const float angle = twoPi * unit(random);
+            waves.push_back({frequency * std::cos(angle), frequency * std::sin(angle), twoPi * unit(random),
+                             baseAmplitude / float(1 << octave) / wavesPerOctave});
+        }
+    }
+
+    xyScale = scale;
+    heightValues.assign(size, std::vector<float>(size));
+    for (long row = 0; row < size; row++) {
+        for (long column = 0; column < size; column++) {
+            float height = 0.0f;
+            for (const Wave& wave : waves) {
+                height += wave.amplitude * std::sin(wave.x * column + wave.y * row + wave.phase);
+            }
+            heightValues[row][column] = height;
+        }
+    }
+
+    buildSurface(pool);
+    return true;
+}
+
+bool Terrain::validate(std::string& problem) const {
+    if (heightValues.size() < 2 || heightValues[0].size() < 2) {
+        problem = "fewer than 2 rows or columns";
+        return false;
+    }
+
+    for (size_t row = 0; row < heightValues.size(); row++) {
+        if (heightValues[row].size() != heightValues[0].size()) {
+            problem = "row " + std::to_string(row) + " has a different width";
+            return false;
+        }
+        for (const float height : heightValues[row]) {
+            if (!std::isfinite(height)) {
+                problem = "row " + std::to_string(row) + " has a height that is not finite";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Terrain::buildSurface(ThreadPool* const pool) {
+    const long nRows = rows();
+    const long nColumns = columns();
+    gridVertices.resize(nRows * nColumns);
+    gridNormals.resize(nRows * nColumns);
+
+    // rows only write their own grid points, so they are independent
+    const auto buildRow = [this, nColumns](const std::size_t row) {
+        for (long column = 0; column < nColumns; column++) {
+            gridVertices[row * nColumns + column] = gridVertex(row, column);
+        }
+        computeNormals(row, 0, nColumns - 1);
     };
 
-    // each square of data is two triangles, but the end values don't have squares,
-    // so we don't need quite as many vertices
-    int nTriangles = (height - 1) * (width - 1) * 2;
-    vertices.resize(3 * nTriangles);
-
-    // Create 2 triangles from square
-    int vertex = 0;
-    for (int row = 0; row < height - 1; row++) {
-        for (int col = 0; col < width - 1; col++) {
-            // Triangle 1
-            vertices[vertex++] = Cartesian3(xyScale * col - midPoint.x,
-                                            midPoint.y - xyScale * row,
-                                            heightValues[row][col]);
-            vertices[vertex++] = Cartesian3(xyScale * (col + 1) - midPoint.x,
-                                            midPoint.y - xyScale * (row + 1),
-                                            heightValues[row + 1][col + 1]);
-            vertices[vertex++] = Cartesian3(xyScale * (col + 1) - midPoint.x,
-                                            midPoint.y - xyScale * row,
-                                            heightValues[row][col + 1]);
-
-            // Triangle 2
-            vertices[vertex++] = Cartesian3(xyScale * col - midPoint.x,
-                                            midPoint.y - xyScale * row,
-                                            heightValues[row][col]);
-            vertices[vertex++] = Cartesian3(xyScale * col - midPoint.x,
-                                            midPoint.y - xyScale * (row + 1),
-                                            heightValues[row + 1][col]);
-            vertices[vertex++] = Cartesian3(xyScale * (col + 1) - midPoint.x,
-                                            midPoint.y - xyScale * (row + 1),
-                                            heightValues[row + 1][col + 1]);
+    if (pool != nullptr) {
+        pool->parallelFor(nRows, buildRow);
+    } else {
+        for (long row = 0; row < nRows; row++) {
+            buildRow(row);
+        }
+    }
+
+    pyramid.build(heightValues);
+}
+
+bool Terrain::setHeights(const long row, const long column, const std::vector<std::vector<float>>& tile) {
+    if (tile.empty() || tile[0].empty()) {
+        return false;
+    }
+    for (const auto& tileRow : tile) {
+        if (tileRow.size() != tile[0].size()) {
+            return false;
+        }
+    }
+
+    const long firstRow = std::max(row, 0L);
+    const long lastRow = std::min(row + static_cast<long>(tile.size()), rows()) - 1;
+    const long firstColumn = std::max(column, 0L);
+    const long lastColumn = std::min(column + static_cast<long>(tile[0].size()), columns()) - 1;
+    if (firstRow > lastRow || firstColumn > lastColumn) {
+        return true;
+    }
+
+    for (long r = firstRow; r <= lastRow; r++) {
+        for (long c = firstColumn; c <= lastColumn; c++) {
+            heightValues[r][c] = tile[r - row][c - column];
+            gridVertices[r * columns() + c] = gridVertex(r, c);
         }
     }
 
-    computeUnitNormalVectors();
+    // central differences reach one grid point beyond the tile
+    for (long r = std::max(firstRow - 1, 0L); r <= std::min(lastRow + 1, rows() - 1); r++) {
+        computeNormals(r, std::max(firstColumn - 1, 0L), std::min(lastColumn + 1, columns() - 1));
+    }
 
+    pyramid.update(heightValues, firstRow, lastRow, firstColumn, lastColumn);
     return true;
 }
 
-float Terrain::getHeight(float x, float y) const {
+bool Terrain::castRay(const Cartesian3& origin,
+                      const Cartesian3& direction,
+                      const float maxDistance,
+                      float& distance) const {
+    if (heightValues.empty()) {
+        return false;
+    }
+
+    Cartesian3 gridOrigin, gridDirection;
+    toGrid(origin, direction, gridOrigin, gridDirection);
+    return pyramid.intersect(heightValues, gridOrigin, gridDirection, maxDistance, distance);
+}
+
+bool Terrain::castRayEverySquare(const Cartesian3& origin,
+                                 const Cartesian3& direction,
+                                 const float maxDistance,
+                                 float& distance) const {
+    if (heightValues.empty()) {
+        return false;
+    }
+
+    Cartesian3 gridOrigin, gridDirection;
+    toGrid(origin, direction, gridOrigin, gridDirection);
+    return HeightPyramid::intersectEverySquare(heightValues, gridOrigin, gridDirection, maxDistance, distance);
+}
+
+void Terrain::castRays(const Cartesian3* origins,
+                       const Cartesian3* directions,
+                       const std::size_t count,
+                       const float maxDistance,
+                       float* distances,
+                       ThreadPool* const pool) const {
+    // rays are handed out in blocks, so a task is worth queueing
+    constexpr std::size_t blockSize = 256;
+    const auto castBlock = [&](const std::size_t block) {
+        const std::size_t end = std::min(count, (block + 1) * blockSize);
+        for (std::size_t ray = block * blockSize; ray < end; ray++) {
+            if (!castRay(origins[ray], directions[ray], maxDistance, distances[ray])) {
+                distances[ray] = std::numeric_limits<float>::infinity();
+            }
+        }
+    };
+
+    const std::size_t blocks = (count + blockSize - 1) / blockSize;
+    if (pool != nullptr) {
+        pool->parallelFor(blocks, castBlock);
+    } else {
+        for (std::size_t block = 0; block < blocks; block++) {
+            castBlock(block);
+        }
+    }
+}
+
+bool Terrain::lineOfSight(const Cartesian3& from, const Cartesian3& to) const {
+    float distance;
+    return !castRay(from, to - from, 1.0f, distance);
+}
+
+float Terrain::getHeight(const float x, const float y) const {
+    long rows[3], columns[3];
+    float weights[3];
+    locate(x, y, rows, columns, weights);
+
     float height = 0.0;
+    for (int corner = 0; corner < 3; corner++) {
+        height += weights[corner] * heightValues[rows[corner]][columns[corner]];
+    }
+
+    return height;
+}
+
+Cartesian3 Terrain::getNormal(const float x, const float y) const {
+    long rows[3], columns[3];
+    float weights[3];
+    locate(x, y, rows, columns, weights);
+
+    Cartesian3 normal(0.0f, 0.0f, 0.0f);
+    for (int corner = 0; corner < 3; corner++) {
+        normal = normal + weights[corner] * gridNormals[rows[corner] * this->columns() + columns[corner]].Vector();
+    }
+
+    return normal.unit();
+}
+
+long Terrain::rows() const {
+    return heightValues.size();
+}
+
+long Terrain::columns() const {
+    return heightValues.empty() ? 0 : heightValues[0].size();
+}
+
+void Terrain::toGrid(const Cartesian3& origin,
+                     const Cartesian3& direction,
+                     Cartesian3& gridOrigin,
+                     Cartesian3& gridDirection) const {
+    // the inverse of gridVertex, heights are kept as they are
+    const float midX = xyScale * (columns() / 2);
+    const float midY = xyScale * (rows() / 2);
+    gridOrigin = Cartesian3((origin.x + midX) / xyScale, (midY - origin.y) / xyScale, origin.z);
+    gridDirection = Cartesian3(direction.x / xyScale, -direction.y / xyScale, direction.z);
+}
 
+Homogeneous4 Terrain::gridVertex(const long row, const long column) const {
+    // We want the triangles to be centred at the origin,
+    // with the zero elevation set at 0 z, so we have to juggle things somewhat
+    const float midX = xyScale * (columns() / 2);
+    const float midY = xyScale * (rows() / 2);
+    return Homogeneous4(xyScale * column - midX, midY - xyScale * row, heightValues[row][column]);
+}
+
+void Terrain::computeNormals(const long row, const long firstColumn, const long lastColumn) {
+    const long nRows = rows();
+    const long nColumns = columns();
+    const long top = std::max(row - 1, 0L);
+    const long bottom = std::min(row + 1, nRows - 1);
+
+    const float* here = heightValues[row].data();
+    const float* above = heightValues[top].data();
+    const float* below = heightValues[bottom].data();
+    Homogeneous4* normals = gridNormals.data() + row * nColumns;
+    const float xFactor = 1.0f / (2.0f * xyScale);
+    // rows run towards -y
+    const float yFactor = 1.0f / (xyScale * (bottom - top));
+
+    // interior columns have both neighbours, the loop is branch free so it vectorises
+    const long first = std::max(firstColumn, 1L);
+    const long last = std::min(lastColumn, nColumns - 2);
+    for (long column = first; column <= last; column++) {
+        const float dx = (here[column + 1] - here[column - 1]) * xFactor;
+        const float dy = (above[column] - below[column]) * yFactor;
+        const float inverseLength = 1.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+        normals[column].x = -dx * inverseLength;
+        normals[column].y = -dy * inverseLength;
+        normals[column].z = inverseLength;
+        normals[column].w = 0.0f;
+    }
+
+    // border columns are one-sided
+    for (const long column : {0L, nColumns - 1}) {
+        if (column < firstColumn || column > lastColumn) {
+            continue;
+        }
+
+        const long left = std::max(column - 1, 0L);
+        const long right = std::min(column + 1, nColumns - 1);
+        const float dx = (here[right] - here[left]) / (xyScale * (right - left));
+        const float dy = (above[column] - below[column]) * yFactor;
+        const Cartesian3 normal = Cartesian3(-dx, -dy, 1.0f).unit();
+        normals[column] = Homogeneous4(normal.x, normal.y, normal.z, 0.0f);
+    }
+}
+
+void Terrain::render(const Matrix4& viewMatrix) const {
+    const long nColumns = columns();
+
+    // each strip alternates between the row below and the row above, so every square is split along the
+    // diagonal from its top left corner, as locate expects
+    for (long row = 0; row + 1 < rows(); row++) {
+        glBegin(GL_TRIANGLE_STRIP);
+        for (long column = 0; column < nColumns; column++) {
+            for (const long stripRow : {row + 1, row}) {
+                const std::size_t index = stripRow * nColumns + column;
+                const Homogeneous4 normal = viewMatrix * gridNormals[index];
+                const Homogeneous4 vertex = viewMatrix * gridVertices[index];
+                glNormal3fv(&normal.x);
+                glVertex4fv(&vertex.x);
+            }
+        }
+        glEnd();
+    }
+}
+
+void Terrain::locate(float x, float y, long rows[3], long columns[3], float weights[3]) const {
     const long nRows = heightValues.size();
     const long nColumns = heightValues[0].size();
 
@@ -94,13 +420,13 @@ float Terrain::getHeight(float x, float y) const {
     // we need to flip coordinates vertically because the rows start at the top
     y = totalHeight - y;
 
-    // now divide by the x-y scale to get the index
-    const long xInteger = x / xyScale;
-    const long yInteger = y / xyScale;
+    // now divide by the x-y scale to get the index, staying on the grid
+    const long xInteger = std::clamp(static_cast<long>(x / xyScale), 0L, nColumns - 2);
+    const long yInteger = std::clamp(static_cast<long>(y / xyScale), 0L, nRows - 2);
 
     // work out the fractional parts
-    const float xRemainder = (x - xyScale * xInteger) / xyScale;
-    const float yRemainder = (y - xyScale * yInteger) / xyScale;
+    const float xRemainder = std::clamp((x - xyScale * xInteger) / xyScale, 0.0f, 1.0f);
+    const float yRemainder = std::clamp((y - xyScale * yInteger) / xyScale, 0.0f, 1.0f);
 
     // find the row and column
     const long row = yInteger;
@@ -115,27 +441,106 @@ float Terrain::getHeight(float x, float y) const {
         // y_remainder is alpha, the barycentric coordinate for the UL corner
         // (1.0 - y_remainder) * x_remainder is beta, the barycentric coordinate for the LR corner
         // (1.0 - y_remainder) * (1.0 - x_remainder) is gamma, the barycentric coordinate for the LL corner
-        const float alpha = yRemainder;
-        const float beta = (1.0 - yRemainder) * xRemainder;
-        const float gamma = 1.0 - alpha - beta;
-
-        // compute and return
-        height = alpha * heightValues[row][column] +
-                 beta * heightValues[row + 1][column + 1] +
-                 gamma * heightValues[row + 1][column];
+        weights[0] = yRemainder;
+        weights[1] = (1.0 - yRemainder) * xRemainder;
+        weights[2] = 1.0 - weights[0] - weights[1];
+
+        rows[0] = row;
+        columns[0] = column;
+        rows[1] = row + 1;
+        columns[1] = column + 1;
+        rows[2] = row + 1;
+        columns[2] = column;
     } else {
         // UR triangle
         // (1.0 - x_remainder) is alpha, the barycentric coordinate for the UL corner
         // x_remainder * y_remainder is beta, the barycentric coordinate for the LR corner
         // x_remainder * (1.0 - y_remainder) is gamma, the barycentric coordinate for the UR corner
-        const float alpha = 1.0 - yRemainder;
-        const float beta = xRemainder * yRemainder;
-        const float gamma = 1.0 - alpha - beta;
+        weights[0] = 1.0 - yRemainder;
+        weights[1] = xRemainder * yRemainder;
+        weights[2] = 1.0 - weights[0] - weights[1];
 
-        height = alpha * heightValues[row][column] +
-                 beta * heightValues[row + 1][column + 1] +
-                 gamma * heightValues[row][column + 1];
+        rows[0] = row;
+        columns[0] = column;
+        rows[1] = row + 1;
+        columns[1] = column + 1;
+        rows[2] = row;
+        columns[2] = column + 1;
     }
+}
 
-    return height;
+void benchmarkRayCasts(const Terrain& terrain, const std::size_t rays, ThreadPool* const pool,
+                       std::ostream& outStream) {
+    // brute force visits every square, so only a few rays are given to it
+    constexpr std::size_t bruteForceRays = 64;
+    if (terrain.heightValues.empty() || rays == 0) {
+        outStream << "ray cast benchmark: no terrain loaded" << std::endl;
+        return;
+    }
+
+    // half picking rays from high above to a point on the ground, half sight lines between points at eye height
+    const long rowCount = terrain.heightValues.size();
+    const long columnCount = terrain.heightValues[0].size();
+    float highest = std::numeric_limits<float>::lowest();
+    for (const auto& row : terrain.heightValues) {
+        highest = std::max(highest, *std::max_element(row.begin(), row.end()));
+    }
+    const float halfWidth = terrain.xyScale * (columnCount - 1) / 2.0f;
+    const float halfHeight = terrain.xyScale * (rowCount - 1) / 2.0f;
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> randomX(-halfWidth, halfWidth);
+    std::uniform_real_distribution<float> randomY(-halfHeight, halfHeight);
+    const auto groundPoint = [&](const float above) {
+        const float x = randomX(random);
+        const float y = randomY(random);
+        return Cartesian3(x, y, terrain.getHeight(x, y) + above);
+    };
+
+    std::vector<Cartesian3> origins(rays), directions(rays);
+    for (std::size_t ray = 0; ray < rays; ray++) {
+        const bool picking = ray % 2 == 0;
+        const Cartesian3 from = picking ? Cartesian3(randomX(random), randomY(random), highest + 50.0f)
+                                        : groundPoint(1.7f);
+        const Cartesian3 to = groundPoint(picking ? 0.0f : 1.7f);
+        origins[ray] = from;
+        directions[ray] = to - from;
+    }
+
+    std::vector<float> distances(rays);
+    std::vector<unsigned char> hits(rays);
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t ray = 0; ray < rays; ray++) {
+        hits[ray] = terrain.castRay(origins[ray], directions[ray], 1.0f, distances[ray]);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double pyramid = rays / elapsed.count();
+
+    // the first few rays are checked against testing every square, which must find the same first hit
+    const std::size_t checked = std::min(rays, bruteForceRays);
+    std::size_t disagreements = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t ray = 0; ray < checked; ray++) {
+        float distance;
+        const bool hit = terrain.castRayEverySquare(origins[ray], directions[ray], 1.0f, distance);
+        if (hit != static_cast<bool>(hits[ray]) || (hit && std::fabs(distance - distances[ray]) > 1e-4f)) {
+            disagreements++;
+        }
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    const double bruteForce = checked / elapsed.count();
+
+    outStream << "ray casts, " << rays << " rays over " << rowCount << "x" << columnCount << " heights, "
+              << std::count(hits.begin(), hits.end(), 1) << " hits\n";
+    outStream << "  every square: " << bruteForce << " rays/s, " << disagreements << " of " << checked
+              << " rays disagree\n";
+    outStream << "  pyramid:      " << pyramid << " rays/s\n";
+
+    if (pool != nullptr) {
+        start = std::chrono::steady_clock::now();
+        terrain.castRays(origins.data(), directions.data(), rays, 1.0f, distances.data(), pool);
+        elapsed = std::chrono::steady_clock::now() - start;
+        outStream << "  batched:      " << rays / elapsed.count() << " rays/s on " << pool->size() << " threads\n";
+    }
+    outStream << std::flush;
 }
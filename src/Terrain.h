@@ -1,24 +1,107 @@
 #ifndef TERRAIN
 #define TERRAIN
 
+#include <cstddef>
+#include <ostream>
+#include <string>
 #include <vector>
 
-#include "HomogeneousFaceSurface.h"
+#include "HeightPyramid.h"
+#include "Homogeneous4.h"
+#include "Matrix4.h"
+#include "ThreadPool.h"
 
-class Terrain : public HomogeneousFaceSurface {
+// Heightfield drawn as a smooth-shaded grid
+// Every grid point is stored once with its own normal, rows of the grid are drawn as triangle strips
+class Terrain {
 public:
     // height value per (x, y) coordinate
     std::vector<std::vector<float>> heightValues;
     float xyScale;
 
+    // grid points as drawn, row by row, heightValues[row][column] is at row * columns + column
+    std::vector<Homogeneous4> gridVertices;
+    // unit normal (w = 0) of each grid point, from the slope of the neighbouring heights
+    std::vector<Homogeneous4> gridNormals;
+
     Terrain();
 
     // reads .dem elevation/terrain model
     // xyScale gives the scale factor to use in the x-y directions
-    bool readTerrainFile(const char* fileName, float xyScale);
+    // normals are computed on pool when one is given, which must not be the pool running this call
+    bool readTerrainFile(const char* fileName, float xyScale, ThreadPool* pool = nullptr);
+
+    // binary terrain format: xy scale and heights, no text parsing on load
+    bool writeBinaryFile(const char* fileName) const;
+
+    bool readBinaryFile(const char* fileName, ThreadPool* pool = nullptr);
+
+    // synthetic size x size hills and valleys, the same for a given seed, for timing grids larger than any .dem
+    // false when size is below 2
+    bool generate(long size, float xyScale, unsigned int seed, ThreadPool* pool = nullptr);
+
+    // false, with the first problem found, when the grid is smaller than 2x2, rows differ in width
+    // or a height is not finite
+    bool validate(std::string& problem) const;
+
+    // replaces the heights of a tile whose top left corner is at (row, column), clipped to the grid
+    // only the tile's grid points and the normals around it are recomputed
+    // false, changing nothing, when the tile is empty or its rows differ in width
+    // not safe while another thread reads the terrain
+    bool setHeights(long row, long column, const std::vector<std::vector<float>>& tile);
 
     // query height at a known (x, y) coordinate
     float getHeight(float x, float y) const;
+
+    // query the unit surface normal at a known (x, y) coordinate
+    // interpolated from the grid normals the same way as the height
+    Cartesian3 getNormal(float x, float y) const;
+
+    // first point of origin + t * direction, t in [0, maxDistance], on or below the surface, see HeightPyramid
+    // distance is t, so in units of direction's length, a ray starting below the surface hits at 0
+    bool castRay(const Cartesian3& origin, const Cartesian3& direction, float maxDistance, float& distance) const;
+
+    // castRay by testing every square of the grid, for measuring castRay against
+    bool castRayEverySquare(const Cartesian3& origin, const Cartesian3& direction, float maxDistance,
+                            float& distance) const;
+
+    // castRay for count rays, spread over pool when one is given, distances of rays that miss are infinity
+    void castRays(const Cartesian3* origins, const Cartesian3* directions, std::size_t count, float maxDistance,
+                  float* distances, ThreadPool* pool = nullptr) const;
+
+    // true when the terrain does not come between from and to
+    bool lineOfSight(const Cartesian3& from, const Cartesian3& to) const;
+
+    // draws the grid with a normal per grid point, for GL_SMOOTH shading
+    void render(const Matrix4& viewMatrix) const;
+
+private:
+    // min/max heights for castRay, kept up to date with heightValues
+    HeightPyramid pyramid;
+
+    long rows() const;
+
+    long columns() const;
+
+    // a ray in the grid space of HeightPyramid, where columns run along x and rows towards -y, one square apart
+    void toGrid(const Cartesian3& origin, const Cartesian3& direction,
+                Cartesian3& gridOrigin, Cartesian3& gridDirection) const;
+
+    // grid points and normals from heightValues and xyScale
+    void buildSurface(ThreadPool* pool);
+
+    // position of the grid point at (row, column), centred on the origin
+    Homogeneous4 gridVertex(long row, long column) const;
+
+    // normals of row in [firstColumn, lastColumn], by central differences and one-sided along the border
+    void computeNormals(long row, long firstColumn, long lastColumn);
+
+    // grid corners and barycentric weights of the triangle under (x, y)
+    void locate(float x, float y, long rows[3], long columns[3], float weights[3]) const;
 };
 
+// times castRay on rays rays between random points above and on terrain, one at a time, batched on pool when one is
+// given, and testing every square on a few of them, and prints rays per second
+void benchmarkRayCasts(const Terrain& terrain, std::size_t rays, ThreadPool* pool, std::ostream& outStream);
+
 #endif
@@ -0,0 +1,75 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount): stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(const std::size_t count, const std::function<void(std::size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    // one task per worker, each claiming indices until none are left
+    std::atomic<std::size_t> next{0};
+    const std::size_t taskCount = std::min<std::size_t>(workers.size(), count);
+    std::vector<std::future<void>> pending;
+    pending.reserve(taskCount);
+
+    for (std::size_t task = 0; task < taskCount; task++) {
+        pending.push_back(submit([&next, &body, count]() {
+            for (std::size_t i = next++; i < count; i = next++) {
+                body(i);
+            }
+        }));
+    }
+
+    for (auto& result : pending) {
+        result.get();
+    }
+}
+
+unsigned int ThreadPool::size() const {
+    return workers.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+            if (tasks.empty()) {
+                // stopping and drained
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+    }
+}
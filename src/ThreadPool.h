@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO task queue
+class ThreadPool {
+public:
+    // 0 picks one thread per hardware core
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    // finishes queued tasks before joining
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto submit(F task) -> std::future<decltype(task())>;
+
+    // runs body(i) for i in [0, count) across the pool and waits for completion
+    // must not be called from a task running on the same pool
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    unsigned int size() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+};
+
+template<typename F>
+auto ThreadPool::submit(F task) -> std::future<decltype(task())> {
+    // std::function needs a copyable target, so share the packaged task
+    auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::move(task));
+    std::future<decltype(task())> result = packaged->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace_back([packaged]() { (*packaged)(); });
+    }
+    available.notify_one();
+
+    return result;
+}
+
+#endif
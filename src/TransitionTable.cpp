@@ -0,0 +1,125 @@
+#include "TransitionTable.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "MemoryTracker.h"
+#include "PoseEvaluator.h"
+
+// how much joint velocities count against joint positions
+constexpr float VELOCITY_WEIGHT = 2.0f;
+
+TransitionTable::TransitionTable() = default;
+
+void TransitionTable::build(const std::vector<const BVH*>& sources, const std::vector<const BVH*>& targets) {
+    MemoryScope memoryScope(MemorySubsystem::ClipStorage);
+
+    sourceIndices.clear();
+    targetIndices.clear();
+    pairOffsets.clear();
+    table.clear();
+
+    std::vector<std::vector<float>> targetFeatures;
+    for (size_t target = 0; target < targets.size(); target++) {
+        targetIndices[targets[target]] = target;
+        targetFeatures.push_back(poseFeatures(*targets[target]));
+    }
+
+    for (size_t source = 0; source < sources.size(); source++) {
+        sourceIndices[sources[source]] = source;
+        const std::vector<float> features = poseFeatures(*sources[source]);
+        const int sourceFrames = sources[source]->frameCount;
+        const size_t dimensions = features.size() / sourceFrames;
+
+        for (size_t target = 0; target < targets.size(); target++) {
+            pairOffsets.push_back(table.size());
+            const std::vector<float>& candidates = targetFeatures[target];
+            const int targetFrames = targets[target]->frameCount;
+
+            // full distance row per source frame, only the best few survive
+            for (int frame = 0; frame < sourceFrames; frame++) {
+                TransitionCandidate best[CANDIDATES];
+                std::fill(best, best + CANDIDATES, TransitionCandidate{0, std::numeric_limits<float>::max()});
+
+                for (int targetFrame = 0; targetFrame < targetFrames; targetFrame++) {
+                    float cost = 0.0f;
+                    for (size_t dimension = 0; dimension < dimensions; dimension++) {
+                        const float difference = features[dimensions * frame + dimension] -
+                                                 candidates[dimensions * targetFrame + dimension];
+                        cost += difference * difference;
+                    }
+
+                    // insertion into the short sorted list
+                    int slot = CANDIDATES;
+                    while (slot > 0 && cost < best[slot - 1].cost) {
+                        if (slot < CANDIDATES) {
+                            best[slot] = best[slot - 1];
+                        }
+                        slot--;
+                    }
+                    if (slot < CANDIDATES) {
+                        best[slot] = TransitionCandidate{static_cast<std::uint32_t>(targetFrame), cost};
+                    }
+                }
+
+                table.insert(table.end(), best, best + CANDIDATES);
+            }
+        }
+    }
+}
+
+bool TransitionTable::empty() const {
+    return table.empty();
+}
+
+int TransitionTable::bestFrame(const BVH& source, const int frame, const BVH& target) const {
+    const TransitionCandidate* best = candidates(source, frame, target);
+    return best == nullptr ? 0 : best->frame;
+}
+
+const TransitionCandidate* TransitionTable::candidates(const BVH& source, const int frame, const BVH& target) const {
+    const auto sourceIndex = sourceIndices.find(&source);
+    const auto targetIndex = targetIndices.find(&target);
+    if (sourceIndex == sourceIndices.end() || targetIndex == targetIndices.end()) {
+        return nullptr;
+    }
+
+    const size_t pair = sourceIndex->second * targetIndices.size() + targetIndex->second;
+    return &table[pairOffsets[pair] + CANDIDATES * (frame % source.frameCount)];
+}
+
+std::size_t TransitionTable::bytes() const {
+    return table.size() * sizeof(TransitionCandidate) + pairOffsets.size() * sizeof(std::size_t);
+}
+
+std::vector<float> TransitionTable::poseFeatures(const BVH& clip) {
+    const Skeleton& skeleton = *clip.skeleton;
+    const std::vector<unsigned char>& mask = skeleton.lodMasks[1];
+    const size_t joints = std::count(mask.begin(), mask.end(), 1);
+    const int frameCount = clip.frameCount;
+
+    // model-space joint positions at BVH scale
+    std::vector<Cartesian3> positions(joints * frameCount);
+    PoseEvaluator evaluator;
+    for (int frame = 0; frame < frameCount; frame++) {
+        evaluator.evaluate(clip, frame, 1.0f, 1);
+        for (size_t joint = 0, kept = 0; joint < mask.size(); joint++) {
+            if (mask[joint]) {
+                positions[joints * frame + kept++] = evaluator.jointMatrices()[joint].origin();
+            }
+        }
+    }
+
+    // clips loop, so velocities wrap around
+    std::vector<float> features;
+    features.reserve(6 * joints * frameCount);
+    for (int frame = 0; frame < frameCount; frame++) {
+        const int next = (frame + 1) % frameCount;
+        for (size_t joint = 0; joint < joints; joint++) {
+            const Cartesian3& position = positions[joints * frame + joint];
+            const Cartesian3 velocity = VELOCITY_WEIGHT * (positions[joints * next + joint] - position);
+            features.insert(features.end(), {position.x, position.y, position.z, velocity.x, velocity.y, velocity.z});
+        }
+    }
+    return features;
+}
@@ -0,0 +1,51 @@
+#ifndef TRANSITION_TABLE_H
+#define TRANSITION_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "BVH.h"
+
+// A frame of the target clip and how far its pose is from the source frame
+// frame is as wide as cost, which the struct is padded to anyway
+struct TransitionCandidate {
+    std::uint32_t frame;
+    float cost;
+};
+
+// Pose distances between every frame of the source clips and every frame of the target clips,
+// reduced to the closest few target frames per source frame
+class TransitionTable {
+public:
+    // candidates kept per source frame and target clip
+    static constexpr int CANDIDATES = 3;
+
+    TransitionTable();
+
+    // targets should loop, playback may start anywhere in them
+    void build(const std::vector<const BVH*>& sources, const std::vector<const BVH*>& targets);
+
+    bool empty() const;
+
+    // frame of target closest to source at frame, 0 when the pair is not in the table
+    int bestFrame(const BVH& source, int frame, const BVH& target) const;
+
+    // CANDIDATES entries ordered by cost, nullptr when the pair is not in the table
+    const TransitionCandidate* candidates(const BVH& source, int frame, const BVH& target) const;
+
+    std::size_t bytes() const;
+
+private:
+    // joint positions and velocities of every frame, for the joints kept at the first level of detail
+    static std::vector<float> poseFeatures(const BVH& clip);
+
+    std::unordered_map<const BVH*, std::size_t> sourceIndices;
+    std::unordered_map<const BVH*, std::size_t> targetIndices;
+    // first candidate of source frame 0 for each (source, target) pair, source major
+    std::vector<std::size_t> pairOffsets;
+    std::vector<TransitionCandidate> table;
+};
+
+#endif
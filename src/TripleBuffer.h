@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+// Lock-free hand-over of whole values from one writer thread to one reader thread
+// The writer fills back() and publishes it, the reader picks up the latest published value with acquire()
+// Neither side ever waits: the third buffer holds the latest value while both sides are busy with their own
+// Buffers are reused, so containers inside them keep their capacity
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer(): writing(0), latest(1), reading(2) {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer side, holds whatever was published two hand-overs ago
+    T& back() {
+        return buffers[writing];
+    }
+
+    // writer side, makes back() the latest value and hands out another buffer to write
+    void publish() {
+        writing = latest.exchange(writing | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader side, the latest published value, which stays untouched until the next acquire()
+    const T& acquire() {
+        if (latest.load(std::memory_order_relaxed) & FRESH) {
+            reading = latest.exchange(reading, std::memory_order_acq_rel) & INDEX;
+        }
+        return buffers[reading];
+    }
+
+private:
+    // the latest index carries whether it was published since the reader last took it
+    static constexpr int INDEX = 3;
+    static constexpr int FRESH = 4;
+
+    std::array<T, 3> buffers;
+    // owned by the writer
+    int writing;
+    std::atomic<int> latest;
+    // owned by the reader
+    int reading;
+};
+
+#endif
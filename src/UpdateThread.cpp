@@ -0,0 +1,51 @@
+#include "UpdateThread.h"
+
+#include <utility>
+
+UpdateThread::UpdateThread(std::function<void()> tick)
+    : tick(std::move(tick)),
+      requested(false),
+      running(false),
+      stopping(false),
+      worker(&UpdateThread::run, this) {
+}
+
+UpdateThread::~UpdateThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+void UpdateThread::requestTick() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requested = true;
+    }
+    changed.notify_all();
+}
+
+void UpdateThread::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !requested && !running; });
+}
+
+void UpdateThread::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return requested || stopping; });
+        if (stopping) {
+            return;
+        }
+
+        requested = false;
+        running = true;
+        lock.unlock();
+        tick();
+        lock.lock();
+        running = false;
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef UPDATE_THREAD_H
+#define UPDATE_THREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs a tick function on a dedicated thread, so the caller can draw the last tick while the next one runs
+class UpdateThread {
+public:
+    explicit UpdateThread(std::function<void()> tick);
+
+    // finishes the running tick and joins
+    ~UpdateThread();
+
+    UpdateThread(const UpdateThread&) = delete;
+
+    UpdateThread& operator=(const UpdateThread&) = delete;
+
+    // starts a tick and returns immediately
+    // requests made while a tick runs are merged into a single tick that follows it
+    void requestTick();
+
+    // blocks until no tick is running or requested
+    void wait();
+
+private:
+    void run();
+
+    std::function<void()> tick;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool requested;
+    bool running;
+    bool stopping;
+    // last member, so the thread starts once everything it touches is constructed
+    std::thread worker;
+};
+
+#endif
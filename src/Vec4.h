@@ -0,0 +1,37 @@
+#ifndef VEC4_H
+#define VEC4_H
+
+#include "Cartesian3.h"
+
+// Four floats on a 16-byte boundary: one SSE register, one RGBA32F texel
+// Storage for bulk arrays of points (w = 1), directions (w = 0), quaternions (x, y, z, w) and matrix rows
+// Arithmetic stays with Cartesian3, Homogeneous4 and Quaternion, this only fixes the layout
+struct alignas(16) Vec4 {
+    float coordinates[4];
+
+    Vec4(): coordinates{0.0f, 0.0f, 0.0f, 0.0f} {
+    }
+
+    Vec4(const float x, const float y, const float z, const float w): coordinates{x, y, z, w} {
+    }
+
+    Vec4(const Cartesian3& vector, const float w): coordinates{vector.x, vector.y, vector.z, w} {
+    }
+
+    float& operator [](const int index) {
+        return coordinates[index];
+    }
+
+    const float& operator [](const int index) const {
+        return coordinates[index];
+    }
+
+    // drops w
+    Cartesian3 xyz() const {
+        return Cartesian3(coordinates[0], coordinates[1], coordinates[2]);
+    }
+};
+
+static_assert(sizeof(Vec4) == 16, "Vec4 must pack into one texel");
+
+#endif
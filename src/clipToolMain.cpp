@@ -0,0 +1,115 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetManager.h"
+#include "BVH.h"
+#include "ClipTool.h"
+#include "PoseBatch.h"
+#include "Terrain.h"
+#include "ThreadPool.h"
+
+static void printUsage(const char* program) {
+    std::cerr << "usage: " << program << " <input directory> <output directory> [options]" << std::endl
+              << "  --threads <count>        worker threads, one per core by default" << std::endl
+              << "  --raw                    write float channels instead of quantized ones" << std::endl
+              << "  --no-bake                keep each clip's channel order" << std::endl
+              << "  --terrain-scale <scale>  x-y scale of .dem terrains, 3 by default" << std::endl
+              << "  --retarget <file.bvh>    retarget every clip onto the skeleton of file.bvh" << std::endl
+              << "       " << program << " --pose-benchmark <file.bvh> [file.bvh ...]" << std::endl
+              << "       " << program << " --ray-benchmark <file.dem|file.terrain|size> [rays]" << std::endl;
+}
+
+// times batched forward kinematics of a crowd cycling through the given clips, see benchmarkPoseBatch
+static int benchmarkPoses(const std::vector<std::string>& fileNames) {
+    // characters posed and the scene's scale
+    constexpr std::size_t characters = 1024;
+    constexpr float scale = 0.1f;
+
+    // no disk cache, clips with identical skeletons share one so that they can be batched together
+    AssetManager assets("");
+    assets.loadClips(fileNames);
+    std::vector<const BVH*> clips;
+    for (const auto& fileName : fileNames) {
+        const std::shared_ptr<const BVH> clip = assets.clip(fileName);
+        if (clip == nullptr) {
+            std::cerr << "Unable to read the clip " << fileName << std::endl;
+            return EXIT_FAILURE;
+        }
+        clips.push_back(clip.get());
+    }
+
+    benchmarkPoseBatch(clips, characters, scale, std::cout);
+    return EXIT_SUCCESS;
+}
+
+// times terrain ray casts on a .dem, read at the scene's scale, a .terrain written by this tool,
+// or a generated size x size grid when given a number
+static int benchmarkTerrain(const std::string& fileName, const std::size_t rays) {
+    ThreadPool pool;
+    Terrain terrain;
+    const float scale = ClipToolOptions().terrainScale;
+    char* end = nullptr;
+    const long size = std::strtol(fileName.data(), &end, 10);
+    const bool generated = !fileName.empty() && *end == '\0';
+    const bool binary = fileName.size() >= 8 && fileName.compare(fileName.size() - 8, 8, ".terrain") == 0;
+    const bool read = generated ? terrain.generate(size, scale, 1, &pool)
+                      : binary  ? terrain.readBinaryFile(fileName.data(), &pool)
+                                : terrain.readTerrainFile(fileName.data(), scale, &pool);
+    if (!read) {
+        std::cerr << "Unable to read the terrain " << fileName << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    benchmarkRayCasts(terrain, rays, &pool, std::cout);
+    return EXIT_SUCCESS;
+}
+
+// headless batch conversion of a directory of .bvh and .dem files, see ClipTool
+int main(int argc, char** argv) {
+    if (argc >= 3 && std::string(argv[1]) == "--pose-benchmark") {
+        return benchmarkPoses(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--ray-benchmark") {
+        return benchmarkTerrain(argv[2], argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100000);
+    }
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string inputDirectory = argv[1];
+    ClipToolOptions options;
+    options.outputDirectory = argv[2];
+    unsigned int threads = 0;
+
+    for (int argument = 3; argument < argc; argument++) {
+        const std::string option = argv[argument];
+        const bool hasValue = argument + 1 < argc;
+        if (option == "--threads" && hasValue) {
+            threads = std::strtoul(argv[++argument], nullptr, 10);
+        } else if (option == "--raw") {
+            options.encoding = ClipEncoding::Raw;
+        } else if (option == "--no-bake") {
+            options.bake = false;
+        } else if (option == "--terrain-scale" && hasValue) {
+            options.terrainScale = std::strtof(argv[++argument], nullptr);
+        } else if (option == "--retarget" && hasValue) {
+            BVH target;
+            if (!target.readBVHFile(argv[++argument])) {
+                std::cerr << "Unable to read the retarget skeleton " << argv[argument] << std::endl;
+                return EXIT_FAILURE;
+            }
+            options.retargetTarget = target.skeleton;
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ThreadPool pool(threads);
+    ClipTool tool(options);
+    return tool.run(inputDirectory, pool, std::cout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
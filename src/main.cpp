@@ -1,13 +1,21 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
 #include <QtWidgets/QApplication>
 
 #include "Scene.h"
 #include "AnimationCycleWidget.h"
+#include "MemoryTracker.h"
 
 int main(int argc, char** argv) {
     QApplication application(argc, argv);
 
+    // allocation test mode: abort if a steady-state update tick touches the heap
+    const char* strictAllocations = std::getenv("SKELETAL_BLEND_STRICT_ALLOCATIONS");
+    if (strictAllocations != nullptr && std::string(strictAllocations) != "0") {
+        MemoryTracker::setStrictTicks(true);
+    }
+
     try {
         Scene scene;
 
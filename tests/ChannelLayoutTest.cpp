@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Affine3x4.h"
+#include "BVH.h"
+#include "ChannelLayout.h"
+#include "Tests.h"
+
+// localMatrix of decoded rotations may differ from composing the recorded order by float rounding only
+constexpr float MATRIX_TOLERANCE = 2e-5f;
+
+// the rotation of angles, with angle[axis] about axis, composed in the given order the way BVH::localMatrix does
+static Affine3x4 composeRecorded(const char* const order, const Cartesian3& angles) {
+    Affine3x4 result = Affine3x4::identity();
+    for (int k = 0; k < 3; k++) {
+        const int axis = order[k] - 'X';
+        const Affine3x4 rotation = axis == 0 ? Affine3x4::rotationX(-angles[axis])
+                                 : axis == 1 ? Affine3x4::rotationY(-angles[axis])
+                                             : Affine3x4::rotationZ(-angles[axis]);
+        result = result * rotation;
+    }
+    return result;
+}
+
+static float matrixError(const Affine3x4& left, const Affine3x4& right) {
+    float error = 0.0f;
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            error = std::max(error, std::fabs(left[row][column] - right[row][column]));
+        }
+    }
+    return error;
+}
+
+std::size_t testChannelLayouts(std::ostream& outStream) {
+    std::size_t failures = 0;
+    const auto fail = [&](const std::string& what) {
+        outStream << "  " << what << std::endl;
+        failures++;
+    };
+
+    // every kind of layout, so both specialised decoders and the generic one are used
+    // -1 marks where the rotation channels go, in the order being tested
+    const struct {
+        ChannelLayoutKind kind;
+        std::vector<int> slots;
+    } shapes[] = {
+        {ChannelLayoutKind::Rotation3, {-1, -1, -1}},
+        {ChannelLayoutKind::Position3Rotation3, {0, 1, 2, -1, -1, -1}},
+        {ChannelLayoutKind::Generic, {-1, 0, -1, 1, 2, -1}},
+    };
+    const char* const positionNames[] = {"Xposition", "Yposition", "Zposition"};
+
+    // large angles and middle angles at and next to +-90 degrees, where only the sum of the outer ones is defined
+    const float values[] = {-175.0f, -90.0f, -89.99f, -33.0f, 0.0f, 12.5f, 90.0f, 90.01f, 140.0f};
+    const Cartesian3 position(3.0f, -7.5f, 42.0f);
+
+    for (const char* const order : {"ZXY", "YXZ", "XZY", "YZX", "ZYX"}) {
+        for (const auto& shape : shapes) {
+            std::vector<std::string> channels;
+            int rotation = 0;
+            for (const int slot : shape.slots) {
+                channels.push_back(slot < 0 ? std::string(1, order[rotation++]) + "rotation" : positionNames[slot]);
+            }
+            const std::vector<JointChannelLayout> layouts = {compileChannelLayout(channels, 0)};
+            const std::string name = std::string(order) + " layout of " + std::to_string(channels.size()) +
+                                     " channels";
+            if (layouts[0].kind != shape.kind) {
+                fail(name + " does not get its decoder");
+            }
+
+            float worst = 0.0f;
+            bool positionsMatch = true;
+            for (const float first : values) {
+                for (const float second : values) {
+                    for (const float third : values) {
+                        // channel values in file order, and the same angles by axis
+                        const float recorded[3] = {first, second, third};
+                        std::vector<float> frame(channels.size());
+                        Cartesian3 angles;
+                        rotation = 0;
+                        for (size_t k = 0; k < shape.slots.size(); k++) {
+                            const int slot = shape.slots[k];
+                            if (slot < 0) {
+                                angles[order[rotation] - 'X'] = recorded[rotation];
+                                frame[k] = recorded[rotation++];
+                            } else {
+                                frame[k] = position[slot];
+                            }
+                        }
+
+                        Cartesian3 decoded, decodedPosition;
+                        decodeFrame(layouts, frame.data(), &decoded, decodedPosition);
+                        worst = std::max(worst, matrixError(BVH::localMatrix(Cartesian3(), decoded),
+                                                            composeRecorded(order, angles)));
+                        if ((layouts[0].flags & HAS_POSITION) != 0) {
+                            positionsMatch = positionsMatch && (decodedPosition - position).length() == 0.0f;
+                        }
+                    }
+                }
+            }
+            if (worst > MATRIX_TOLERANCE) {
+                fail(name + " decodes to a rotation " + std::to_string(worst) + " off the recorded one");
+            }
+            if (!positionsMatch) {
+                fail(name + " does not decode its position");
+            }
+        }
+    }
+    return failures;
+}
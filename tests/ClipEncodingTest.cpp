@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BVH.h"
+#include "Tests.h"
+
+// a root and one joint, every channel in X, Y, Z order so decoding copies values unchanged
+static const char* const CLIP_HIERARCHY =
+    "HIERARCHY\n"
+    "ROOT Hips\n"
+    "{\n"
+    "\tOFFSET 0 0 0\n"
+    "\tCHANNELS 6 Xposition Yposition Zposition Xrotation Yrotation Zrotation\n"
+    "\tJOINT Spine\n"
+    "\t{\n"
+    "\t\tOFFSET 0 10 0\n"
+    "\t\tCHANNELS 3 Xrotation Yrotation Zrotation\n"
+    "\t\tEnd Site\n"
+    "\t\t{\n"
+    "\t\t\tOFFSET 0 10 0\n"
+    "\t\t}\n"
+    "\t}\n"
+    "}\n";
+
+// frames whose rotations sweep almost a full turn, positions a range of 500 and 3, and Yposition and the
+// spine's Yrotation constant
+static std::vector<std::vector<float>> clipFrames(const int frameCount) {
+    std::vector<std::vector<float>> frames;
+    for (int frame = 0; frame < frameCount; frame++) {
+        const float phase = 0.37f * frame;
+        frames.push_back({500.0f * frame / (frameCount - 1), 90.0f, 1.5f * std::sin(phase),
+                          179.9f * std::sin(phase), -179.9f * std::cos(1.3f * phase), 35.0f * std::sin(0.5f * phase),
+                          170.0f * std::cos(phase), 12.5f, -60.0f + 3.0f * frame});
+    }
+    return frames;
+}
+
+static bool readClip(const std::vector<std::vector<float>>& frames, BVH& clip) {
+    // with decimals, as exporters write them and readMotion expects
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(6) << CLIP_HIERARCHY << "MOTION\nFrames: " << frames.size() << "\nFrame Time: 0.0333333\n";
+    for (const auto& frame : frames) {
+        for (const float value : frame) {
+            text << (&value == frame.data() ? "" : " ") << value;
+        }
+        text << '\n';
+    }
+    std::istringstream inStream(text.str());
+    return clip.readBVH(inStream);
+}
+
+// largest difference of one channel between two clips, over every frame
+static float channelError(const BVH& left, const BVH& right, const int channel) {
+    Cartesian3 leftScratch[2], rightScratch[2];
+    float error = 0.0f;
+    for (int frame = 0; frame < left.frameCount; frame++) {
+        const float leftValue = channel < 3 ? left.rootPosition(frame)[channel]
+                                            : left.rotations(frame, leftScratch)[(channel - 3) / 3][channel % 3];
+        const float rightValue = channel < 3 ? right.rootPosition(frame)[channel]
+                                             : right.rotations(frame, rightScratch)[(channel - 3) / 3][channel % 3];
+        error = std::max(error, std::fabs(leftValue - rightValue));
+    }
+    return error;
+}
+
+std::size_t testClipEncoding(std::ostream& outStream) {
+    std::size_t failures = 0;
+    const auto fail = [&](const std::string& what) {
+        outStream << "  " << what << std::endl;
+        failures++;
+    };
+
+    const std::vector<std::vector<float>> frames = clipFrames(40);
+    BVH original;
+    if (!readClip(frames, original)) {
+        fail("the test clip does not parse");
+        return failures;
+    }
+
+    const std::string fileName = (std::filesystem::temp_directory_path() / "skeletal-blend-test.clip").string();
+    BVH quantized;
+    if (!original.writeBinaryFile(fileName.data(), ClipEncoding::Quantized) ||
+        !quantized.readBinaryFile(fileName.data()) || quantized.frameCount != original.frameCount) {
+        fail("a quantized clip does not read back");
+        std::remove(fileName.data());
+        return failures;
+    }
+
+    // rotations within the documented 0.003 degrees, positions within range / 131070, constant channels exact
+    const std::size_t channels = frames[0].size();
+    for (std::size_t channel = 0; channel < channels; channel++) {
+        float minimum = frames[0][channel], maximum = minimum;
+        for (const auto& frame : frames) {
+            minimum = std::min(minimum, frame[channel]);
+            maximum = std::max(maximum, frame[channel]);
+        }
+        const float bound = maximum == minimum ? 0.0f : channel < 3 ? (maximum - minimum) / 131070.0f : 0.003f;
+        const float error = channelError(original, quantized, channel);
+        if (error > bound) {
+            fail("channel " + std::to_string(channel) + " is " + std::to_string(error) + " off, more than " +
+                 std::to_string(bound));
+        }
+    }
+
+    // every shorter copy of the file is rejected
+    std::ifstream inFile(fileName, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+    inFile.close();
+    std::size_t accepted = 0;
+    for (std::size_t length = 0; length < bytes.size(); length++) {
+        std::ofstream(fileName, std::ios::binary | std::ios::trunc).write(bytes.data(), length);
+        BVH truncated;
+        accepted += truncated.readBinaryFile(fileName.data());
+    }
+    if (accepted != 0) {
+        fail(std::to_string(accepted) + " truncated quantized clips read without an error");
+    }
+
+    std::remove(fileName.data());
+    return failures;
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cmath>
+
+#include "FastMath.h"
+#include "Tests.h"
+
+// prints a failure when error exceeds bound
+static std::size_t checkBound(const char* what, const double error, const double bound, std::ostream& outStream) {
+    if (error <= bound) {
+        return 0;
+    }
+    outStream << "  " << what << ": error " << error << " exceeds " << bound << std::endl;
+    return 1;
+}
+
+std::size_t testFastMath(std::ostream& outStream) {
+    std::size_t failures = 0;
+
+    // the documented range, finely sampled, against std:: at the same float arguments
+    double sineError = 0.0, cosineError = 0.0;
+    for (double x = -FAST_SINCOS_RANGE; x <= FAST_SINCOS_RANGE; x += 0.0007) {
+        const float radians = static_cast<float>(x);
+        float sine, cosine;
+        fastSinCos(radians, sine, cosine);
+        sineError = std::max(sineError, static_cast<double>(std::fabs(sine - std::sin(radians))));
+        cosineError = std::max(cosineError, static_cast<double>(std::fabs(cosine - std::cos(radians))));
+    }
+    failures += checkBound("fastSinCos sine", sineError, FAST_SINCOS_MAX_ERROR, outStream);
+    failures += checkBound("fastSinCos cosine", cosineError, FAST_SINCOS_MAX_ERROR, outStream);
+
+    // the quadrant boundaries, where reduction and sign selection switch
+    for (int quadrant = -64; quadrant <= 64; quadrant++) {
+        for (const float offset : {-1e-4f, 0.0f, 1e-4f}) {
+            const float radians = quadrant * FAST_PI / 2.0f + offset;
+            float sine, cosine;
+            fastSinCos(radians, sine, cosine);
+            failures += checkBound("fastSinCos at a quadrant boundary",
+                                   std::max(std::fabs(sine - std::sin(radians)), std::fabs(cosine - std::cos(radians))),
+                                   FAST_SINCOS_MAX_ERROR, outStream);
+        }
+    }
+
+    // the array overload gives the same results as one angle at a time
+    constexpr std::size_t COUNT = 64;
+    float angles[COUNT], sines[COUNT], cosines[COUNT];
+    for (std::size_t i = 0; i < COUNT; i++) {
+        angles[i] = (static_cast<float>(i) - COUNT / 2.0f) * 0.37f;
+    }
+    fastSinCos(angles, sines, cosines, COUNT);
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < COUNT; i++) {
+        float sine, cosine;
+        fastSinCos(angles[i], sine, cosine);
+        mismatches += sine != sines[i] || cosine != cosines[i];
+    }
+    failures += checkBound("fastSinCos array overload, mismatching angles", mismatches, 0, outStream);
+
+    // the whole domain, including both ends
+    double acosError = 0.0;
+    for (double x = -1.0; x <= 1.0; x += 1e-6) {
+        const float value = static_cast<float>(x);
+        acosError = std::max(acosError, static_cast<double>(std::fabs(fastAcos(value) - std::acos(value))));
+    }
+    for (const float value : {-1.0f, 0.0f, 1.0f}) {
+        acosError = std::max(acosError, static_cast<double>(std::fabs(fastAcos(value) - std::acos(value))));
+    }
+    failures += checkBound("fastAcos", acosError, FAST_ACOS_MAX_ERROR, outStream);
+
+    // the compile-time ring matches std:: to float precision
+    constexpr int STEPS = 20;
+    constexpr RingTable<STEPS> ring = makeRingTable<STEPS>();
+    double ringError = 0.0;
+    for (int step = 0; step < STEPS; step++) {
+        const double angle = 2.0 * M_PI * step / STEPS;
+        ringError = std::max(ringError, std::fabs(ring.cosines[step] - std::cos(angle)));
+        ringError = std::max(ringError, std::fabs(ring.sines[step] - std::sin(angle)));
+    }
+    failures += checkBound("makeRingTable", ringError, 1e-7, outStream);
+
+    return failures;
+}
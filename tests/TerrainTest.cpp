@@ -0,0 +1,139 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Terrain.h"
+#include "Tests.h"
+
+// heights of a rows x columns grid with slopes in every direction
+static std::vector<std::vector<float>> rollingHeights(const long rows, const long columns) {
+    std::vector<std::vector<float>> heights(rows, std::vector<float>(columns));
+    for (long row = 0; row < rows; row++) {
+        for (long column = 0; column < columns; column++) {
+            heights[row][column] = 4.0f * std::sin(0.31f * row) * std::cos(0.17f * column) + 0.05f * column;
+        }
+    }
+    return heights;
+}
+
+// a terrain built from scratch out of heights, through the binary format
+static bool buildTerrain(const std::vector<std::vector<float>>& heights, const float xyScale, Terrain& terrain) {
+    const std::string fileName = (std::filesystem::temp_directory_path() / "skeletal-blend-test.terrain").string();
+    Terrain source;
+    source.heightValues = heights;
+    source.xyScale = xyScale;
+    const bool built = source.writeBinaryFile(fileName.data()) && terrain.readBinaryFile(fileName.data());
+    std::remove(fileName.data());
+    return built;
+}
+
+static bool sameVectors(const std::vector<Homogeneous4>& left, const std::vector<Homogeneous4>& right) {
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); i++) {
+        if (left[i].x != right[i].x || left[i].y != right[i].y || left[i].z != right[i].z || left[i].w != right[i].w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// sight lines skimming the surface between grid points, where a stale height range would wrongly skip a node
+// left is tested against right and against testing every square of left
+static std::size_t differentRays(const Terrain& left, const Terrain& right) {
+    const long rows = left.heightValues.size(), columns = left.heightValues[0].size();
+    const auto point = [&](const long index, const float above) {
+        const long row = (index * 7) % rows, column = (index * 13) % columns;
+        const Homogeneous4& vertex = left.gridVertices[row * columns + column];
+        return Cartesian3(vertex.x, vertex.y, vertex.z + above);
+    };
+
+    std::size_t different = 0;
+    for (long ray = 0; ray < 2000; ray++) {
+        const Cartesian3 from = point(ray, 0.5f);
+        const Cartesian3 direction = point(ray * 31 + 5, 0.5f) - from;
+        float leftDistance = 0.0f, rightDistance = 0.0f, everyDistance = 0.0f;
+        const bool leftHit = left.castRay(from, direction, 1.0f, leftDistance);
+        const bool rightHit = right.castRay(from, direction, 1.0f, rightDistance);
+        const bool everyHit = left.castRayEverySquare(from, direction, 1.0f, everyDistance);
+        different += leftHit != rightHit || (leftHit && leftDistance != rightDistance);
+        different += leftHit != everyHit || (leftHit && std::fabs(leftDistance - everyDistance) > 1e-4f);
+    }
+    return different;
+}
+
+std::size_t testTerrainEdits(std::ostream& outStream) {
+    std::size_t failures = 0;
+    const auto fail = [&](const char* what) {
+        outStream << "  " << what << std::endl;
+        failures++;
+    };
+
+    // odd and even sides, so the grid is not centred on a grid point in both directions
+    constexpr long ROWS = 37, COLUMNS = 54;
+    constexpr float XY_SCALE = 3.0f;
+    std::vector<std::vector<float>> heights = rollingHeights(ROWS, COLUMNS);
+    Terrain edited;
+    if (!buildTerrain(heights, XY_SCALE, edited)) {
+        fail("cannot build the terrain");
+        return failures;
+    }
+
+    // an interior tile, one hanging over the top left corner and one over the bottom right, clipped to the grid
+    const struct {
+        long row, column, rows, columns;
+        float height;
+    } tiles[] = {
+        {10, 20, 6, 9, 7.5f},
+        {-3, -2, 5, 6, -2.0f},
+        {ROWS - 4, COLUMNS - 3, 8, 8, 3.25f},
+    };
+    for (const auto& tile : tiles) {
+        std::vector<std::vector<float>> values(tile.rows, std::vector<float>(tile.columns));
+        for (long row = 0; row < tile.rows; row++) {
+            for (long column = 0; column < tile.columns; column++) {
+                values[row][column] = tile.height + 0.1f * row - 0.2f * column;
+                const long gridRow = tile.row + row, gridColumn = tile.column + column;
+                if (gridRow >= 0 && gridRow < ROWS && gridColumn >= 0 && gridColumn < COLUMNS) {
+                    heights[gridRow][gridColumn] = values[row][column];
+                }
+            }
+        }
+        if (!edited.setHeights(tile.row, tile.column, values)) {
+            fail("setHeights rejects a rectangular tile");
+        }
+    }
+
+    // the edited terrain matches one built from the edited heights exactly
+    Terrain rebuilt;
+    if (!buildTerrain(heights, XY_SCALE, rebuilt)) {
+        fail("cannot rebuild the terrain");
+        return failures;
+    }
+    if (edited.heightValues != rebuilt.heightValues) {
+        fail("edited heights differ from the rebuilt ones");
+    }
+    if (!sameVectors(edited.gridVertices, rebuilt.gridVertices)) {
+        fail("edited grid points differ from the rebuilt ones");
+    }
+    if (!sameVectors(edited.gridNormals, rebuilt.gridNormals)) {
+        fail("edited normals differ from the rebuilt ones");
+    }
+    if (differentRays(edited, rebuilt) != 0) {
+        fail("rays cast against the edited terrain differ from the rebuilt one");
+    }
+
+    // a ragged tile would be indexed past the end of its short rows, it is rejected as a whole
+    const std::vector<std::vector<float>> ragged = {{1.0f, 2.0f, 3.0f}, {4.0f}};
+    if (edited.setHeights(5, 5, ragged) || edited.heightValues != rebuilt.heightValues) {
+        fail("setHeights accepts a ragged tile");
+    }
+    if (edited.setHeights(5, 5, {})) {
+        fail("setHeights accepts an empty tile");
+    }
+
+    return failures;
+}
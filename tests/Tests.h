@@ -0,0 +1,17 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <cstddef>
+#include <ostream>
+
+// Each group of tests prints its failures to outStream and returns how many there were
+
+std::size_t testFastMath(std::ostream& outStream);
+
+std::size_t testChannelLayouts(std::ostream& outStream);
+
+std::size_t testClipEncoding(std::ostream& outStream);
+
+std::size_t testTerrainEdits(std::ostream& outStream);
+
+#endif
@@ -0,0 +1,25 @@
+#include <cstdlib>
+#include <iostream>
+
+#include "Tests.h"
+
+// runs every group of tests, exits with a failure status if any test fails
+int main() {
+    const struct {
+        const char* name;
+        std::size_t (*run)(std::ostream&);
+    } groups[] = {
+        {"fast math", testFastMath},
+        {"channel layouts", testChannelLayouts},
+        {"clip encoding", testClipEncoding},
+        {"terrain edits", testTerrainEdits},
+    };
+
+    std::size_t failures = 0;
+    for (const auto& group : groups) {
+        const std::size_t groupFailures = group.run(std::cout);
+        std::cout << group.name << ": " << (groupFailures == 0 ? "passed" : "FAILED") << std::endl;
+        failures += groupFailures;
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}